@@ -8,7 +8,7 @@ const buildZqField = require("../index.js").buildZqField;
 const bigInt = require("big-integer");
 const N = 1000000000;
 
-async function benchmarkMM(op, prime) {
+async function benchmarkMM(op, prime, flags) {
     const dir = await tmp.dir({prefix: "circom_", unsafeCleanup: true });
     
     const source = await buildZqField(prime, "Fr");
@@ -16,8 +16,8 @@ async function benchmarkMM(op, prime) {
     // console.log(dir.path);
 
     await fs.promises.writeFile(path.join(dir.path, "fr.asm"), source.asm, "utf8");
-    await fs.promises.writeFile(path.join(dir.path, "fr.hpp"), source.h, "utf8");
-    await fs.promises.writeFile(path.join(dir.path, "fr.cpp"), source.c, "utf8");
+    await fs.promises.writeFile(path.join(dir.path, "fr.hpp"), source.hpp, "utf8");
+    await fs.promises.writeFile(path.join(dir.path, "fr.cpp"), source.cpp, "utf8");
 
     await exec(`cp  ${path.join(__dirname,  `${op}.cpp`)} ${dir.path}`);
 
@@ -36,12 +36,14 @@ async function benchmarkMM(op, prime) {
        ` ${path.join(dir.path,  "fr.o")}` +
        ` ${path.join(dir.path,  "fr.cpp")}` +
        ` -o ${path.join(dir.path, "benchmark")}` +
-       " -lgmp -O3"
+       " -lgmp -O3" +
+       (flags ? ` ${flags}` : "")
     );
 
     const t1 = performance.now();
 
-    await exec(`${path.join(dir.path,  "benchmark")} ${N}`);
+    const { stdout } = await exec(`${path.join(dir.path,  "benchmark")} ${N}`);
+    process.stdout.write(stdout);
 
     const t2 = performance.now();
 
@@ -111,6 +113,32 @@ async function run() {
     // t = await benchmarkMM("rawmmul", bigInt("41898490967918953402344214791240637128170709919953949071783502921025352812571106773058893763790338921418070971888253786114353726529584385201591605722013126468931404347949840543007986327743462853720628051692141265303114721689601"));
     // console.log("Raw multiplication mnt6753 Montgomery IntelASM: " + (t/1000) + "s " + (t * 1e6 / N) + "ns per multiplication.");
 
+    t = await benchmarkMM("rawmmul", bigInt("21888242871839275222246405745257275088548364400416034343698204186575808495617"), "-DUSE_INLINE_RAW");
+    console.log("Raw multiplication bn256r Montgomery Inline: " + (t/1000) + "s " + (t * 1e6 / N) + "ns per multiplication.");
+
+    t = await benchmarkMM("rawmmul", bigInt("4002409555221667393417789825735904156556882819939007885332058136124031650490837864442687629129015664037894272559787"), "-DUSE_INLINE_RAW");
+    console.log("Raw multiplication bls12-381 Montgomery Inline: " + (t/1000) + "s " + (t * 1e6 / N) + "ns per multiplication.");
+
+    t = await benchmarkMM("rawmmulbatch", bigInt("21888242871839275222246405745257275088548364400416034343698204186575808495617"));
+    console.log("Raw batch multiplication bn256r Montgomery IFMA: " + (t/1000) + "s " + (t * 1e6 / N) + "ns per multiplication.");
+
+    t = await benchmarkMM("rawmmulbatch", bigInt("4002409555221667393417789825735904156556882819939007885332058136124031650490837864442687629129015664037894272559787"));
+    console.log("Raw batch multiplication bls12-381 Montgomery IFMA: " + (t/1000) + "s " + (t * 1e6 / N) + "ns per multiplication.");
+
+
+    //  BUTTERFLY
+    t = await benchmarkMM("rawbutterfly", bigInt("21888242871839275222246405745257275088548364400416034343698204186575808495617"));
+    console.log("Raw butterfly bn256r Montgomery IntelASM: " + (t/1000) + "s " + (t * 1e6 / N) + "ns per butterfly.");
+
+    t = await benchmarkMM("rawbutterfly", bigInt("21888242871839275222246405745257275088548364400416034343698204186575808495617"), "-DUSE_INLINE_RAW");
+    console.log("Raw butterfly bn256r Montgomery Inline: " + (t/1000) + "s " + (t * 1e6 / N) + "ns per butterfly.");
+
+    t = await benchmarkMM("rawbutterfly", bigInt("4002409555221667393417789825735904156556882819939007885332058136124031650490837864442687629129015664037894272559787"));
+    console.log("Raw butterfly bls12-381 Montgomery IntelASM: " + (t/1000) + "s " + (t * 1e6 / N) + "ns per butterfly.");
+
+    t = await benchmarkMM("rawbutterfly", bigInt("4002409555221667393417789825735904156556882819939007885332058136124031650490837864442687629129015664037894272559787"), "-DUSE_INLINE_RAW");
+    console.log("Raw butterfly bls12-381 Montgomery Inline: " + (t/1000) + "s " + (t * 1e6 / N) + "ns per butterfly.");
+
 
     //  SQUARE
     t = await benchmarkMM("square", bigInt("21888242871839275222246405745257275088548364400416034343698204186575808495617"));
@@ -132,6 +160,19 @@ async function run() {
     // console.log("Raw square mnt6753 Montgomery IntelASM: " + (t/1000) + "s " + (t * 1e6 / N) + "ns per multiplication.");
 
 
+    //  FFT (10 transforms of 2^20 elements)
+    const fftFlags = `-I${path.join(__dirname, "..", "c")} ${path.join(__dirname, "..", "c", "goldilocks.cpp")} -fopenmp`;
+
+    t = await benchmarkMM("fft", bigInt("21888242871839275222246405745257275088548364400416034343698204186575808495617"), fftFlags);
+    console.log("FFT 2^20 bn256r Montgomery IntelASM: " + (t/1000) + "s " + (t / 10) + "ms per FFT.");
+
+    t = await benchmarkMM("fft", bigInt("21888242871839275222246405745257275088548364400416034343698204186575808495617"), fftFlags + " -DGOLDILOCKS");
+    console.log("FFT 2^20 Goldilocks SIMD: " + (t/1000) + "s " + (t / 10) + "ms per FFT.");
+
+    //  Bit reversal permutation, 2^20 to 2^MAX_LOG elements (prints its own timings)
+    await benchmarkMM("bitreverse", bigInt("21888242871839275222246405745257275088548364400416034343698204186575808495617"), fftFlags + " -DMAX_LOG=26");
+    await benchmarkMM("bitreverse", bigInt("21888242871839275222246405745257275088548364400416034343698204186575808495617"), fftFlags + " -DGOLDILOCKS -DMAX_LOG=28");
+
 }
 
 run();
@@ -0,0 +1,59 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include "fr.hpp"
+#include "goldilocks.hpp"
+
+// FFT::reversePermutation (COBRA tiles) against the flat loop that swaps a[i] and a[BR(i)],
+// for 2^20 to 2^MAX_LOG elements. -DGOLDILOCKS for 8 byte elements, RawFr otherwise.
+#ifdef GOLDILOCKS
+typedef GoldilocksField Field;
+#else
+typedef RawFr Field;
+#endif
+
+#ifndef MAX_LOG
+#define MAX_LOG 28
+#endif
+
+static double elapsed(std::chrono::steady_clock::time_point t0) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+}
+
+int main(int argc, char **argv) {
+
+    Field &F = Field::field;
+    // reversePermutation does not use the roots, so no need for a table of 2^MAX_LOG
+    FFT<Field> fft(2);
+
+    for (int lg=20; lg<=MAX_LOG; lg++) {
+        const uint64_t n = 1ULL << lg;
+        Field::Element *a = new Field::Element[n];
+        for (uint64_t i=0; i<n; i++) F.fromUI(a[i], i);
+
+        auto t0 = std::chrono::steady_clock::now();
+        #pragma omp parallel for
+        for (uint64_t i=0; i<n; i++) {
+            uint64_t r = BR(i, lg);
+            if (i>r) F.swap(a[i], a[r]);
+        }
+        double tFlat = elapsed(t0);
+
+        t0 = std::chrono::steady_clock::now();
+        fft.reversePermutation(a, n);
+        double tCobra = elapsed(t0);
+
+        // Both permutations together are the identity
+        for (uint64_t i=0; i<n; i++) {
+            Field::Element e;
+            F.fromUI(e, i);
+            if (!F.eq(a[i], e)) {
+                printf("Bit reversal 2^%d: wrong result at %lu\n", lg, (unsigned long)i);
+                return 1;
+            }
+        }
+
+        printf("Bit reversal 2^%d %d bytes: flat %.1fms COBRA %.1fms\n", lg, (int)sizeof(Field::Element), tFlat, tCobra);
+        delete[] a;
+    }
+}
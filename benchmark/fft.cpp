@@ -0,0 +1,31 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "fr.hpp"
+#include "goldilocks.hpp"
+
+// -DGOLDILOCKS for FFT<GoldilocksField>, FFT<RawFr> otherwise
+#ifdef GOLDILOCKS
+typedef GoldilocksField Field;
+#else
+typedef RawFr Field;
+#endif
+
+int main(int argc, char **argv) {
+
+    const uint64_t n = 1 << 20;
+    const int nFFTs = 10;
+
+    Field &F = Field::field;
+    FFT<Field> fft(n);
+
+    Field::Element *a = new Field::Element[n];
+    for (uint64_t i=0; i<n; i++) {
+        F.fromUI(a[i], i*i + 1);
+    }
+
+    for (int k=0; k<nFFTs; k++) {
+        fft.fft(a, n);
+    }
+
+    delete[] a;
+}
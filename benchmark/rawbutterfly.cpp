@@ -0,0 +1,29 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "fr.hpp"
+
+// FFT like loop: independent butterflies over an array, where inlined field operations
+// can be scheduled together.
+int main(int argc, char **argv) {
+
+    int N = atoi(argv[1]);
+    const int n = 1024;
+
+    RawFr F;
+
+    RawFr::Element *v = new RawFr::Element[n];
+    RawFr::Element w, t, u;
+    F.fromString(w, "19103219067921713944291392827692070036145651957329286315305642004821462161904");
+    for (int i=0; i<n; i++) F.fromString(v[i], "99999999999");
+
+    for (int k=0; k<N/(n/2); k++) {
+        for (int i=0; i<n/2; i++) {
+            F.mul(t, w, v[i + n/2]);
+            F.copy(u, v[i]);
+            F.add(v[i], u, t);
+            F.sub(v[i + n/2], u, t);
+        }
+    }
+
+    delete[] v;
+}
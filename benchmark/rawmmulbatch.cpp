@@ -0,0 +1,25 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "fr.hpp"
+
+int main(int argc, char **argv) {
+
+    int N = atoi(argv[1]);
+    const int n = 1024;
+
+    RawFr F;
+
+    RawFr::Element *a = new RawFr::Element[n];
+    RawFr::Element *b = new RawFr::Element[n];
+    for (int i=0; i<n; i++) {
+        F.fromUI(a[i], i+1);
+        F.fromString(b[i], "19103219067921713944291392827692070036145651957329286315305642004821462161904");
+    }
+
+    for (int k=0; k<N/n; k++) {
+        F.mulBatch(a, a, b, n);
+    }
+
+    delete[] a;
+    delete[] b;
+}
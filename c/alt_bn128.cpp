@@ -3,10 +3,12 @@
 namespace AltBn128 {
 
 RawFq F1;
-F2Field<RawFq> F2("-1");
+F2Type F2("-1");
+F6Field< F2Type > F6(F2, "9,1");
+F12Field< F6Field< F2Type > > F12(F6);
 RawFr Fr;
-Curve<RawFq> G1(F1, "0", "3", "1", "2");
-Curve< F2Field<RawFq> > G2(
+G1Type G1(F1, "0", "3", "1", "2");
+G2Type G2(
     F2,
     "0,0", 
     "19485874751759354771024239261021720505790618469301721065564631296452457478373, 266929791119991161246907387137283842545076965332900288569378510910307636690",
@@ -16,4 +18,6 @@ Curve< F2Field<RawFq> > G2(
 
 Engine Engine::engine;
 
+BnPairing<Engine> Pairing(Engine::engine, "4965661367192848881");
+
 } // namespace
\ No newline at end of file
@@ -4,35 +4,51 @@
 #include "fq.hpp"
 #include "fr.hpp"
 #include "f2field.hpp"
+#include "f6field.hpp"
+#include "f12field.hpp"
 #include "curve.hpp"
+#include "pairing.hpp"
 #include <string>
 namespace AltBn128 {
 
+    // a = 0 on both groups and Fq2 = Fq[i]/(i^2 + 1), so the formulas are specialized at compile time.
+    typedef F2Field<RawFq, F2FieldTraits<param_negone> > F2Type;
+    typedef Curve<RawFq, CurveTraits<param_zero> > G1Type;
+    typedef Curve<F2Type, CurveTraits<param_zero> > G2Type;
+
     typedef RawFq::Element F1Element;
-    typedef F2Field<RawFq>::Element F2Element;
+    typedef F2Type::Element F2Element;
+    typedef F6Field< F2Type >::Element F6Element;
+    typedef F12Field< F6Field< F2Type > >::Element F12Element;
     typedef RawFr::Element FrElement;
-    typedef Curve<RawFq>::Point G1Point;
-    typedef Curve<RawFq>::PointAffine G1PointAffine;
-    typedef Curve< F2Field<RawFq> >::Point G2Point;
-    typedef Curve< F2Field<RawFq> >::PointAffine G2PointAffine;
+    typedef G1Type::Point G1Point;
+    typedef G1Type::PointAffine G1PointAffine;
+    typedef G2Type::Point G2Point;
+    typedef G2Type::PointAffine G2PointAffine;
 
     extern RawFq F1;
-    extern F2Field<RawFq> F2;
+    extern F2Type F2;
+    extern F6Field< F2Type > F6;
+    extern F12Field< F6Field< F2Type > > F12;
     extern RawFr Fr;
-    extern Curve<RawFq> G1;
-    extern Curve< F2Field<RawFq> > G2;
+    extern G1Type G1;
+    extern G2Type G2;
 
     class Engine {
     public:
 
         typedef RawFq F1;
-        typedef F2Field<RawFq> F2;
+        typedef F2Type F2;
+        typedef F6Field<F2> F6;
+        typedef F12Field<F6> F12;
         typedef RawFr Fr;
-        typedef Curve<RawFq> G1;
-        typedef Curve< F2Field<RawFq> > G2;
+        typedef G1Type G1;
+        typedef G2Type G2;
 
         F1 f1;
         F2 f2;
+        F6 f6;
+        F12 f12;
         Fr fr;
         G1 g1;
         G2 g2;
@@ -40,6 +56,8 @@ namespace AltBn128 {
         Engine() : 
             f1(), 
             f2("-1"), 
+            f6(f2, "9,1"),
+            f12(f6),
             fr(), 
             g1(f1, "0", "3", "1", "2"), 
             g2(
@@ -52,6 +70,8 @@ namespace AltBn128 {
 
         typedef F1::Element F1Element;
         typedef F2::Element F2Element;
+        typedef F6::Element F6Element;
+        typedef F12::Element F12Element;
         typedef Fr::Element FrElement;
         typedef G1::Point G1Point;
         typedef G1::PointAffine G1PointAffine;
@@ -61,6 +81,8 @@ namespace AltBn128 {
         static Engine engine;
     };
 
+    extern BnPairing<Engine> Pairing;
+
 }  // Namespace
 
 #endif
\ No newline at end of file
@@ -4,6 +4,8 @@
 #include "gtest/gtest.h"
 #include "alt_bn128.hpp"
 #include "fft.hpp"
+#include "goldilocks.hpp"
+#include "groth16_verifier.hpp"
 
 using namespace AltBn128;
 
@@ -28,6 +30,79 @@ TEST(altBn128, f2_simpleMul) {
     ASSERT_TRUE(F2.eq(e3, e33));
 }
 
+TEST(altBn128, f2_mulLazyReduction) {
+    // Operands close to q maximize the unreduced products.
+    F2Element e1;
+    F2.fromString(e1, "(21888242871839275222246405745257275088696311157297823662689037894645226208582,21888242871839275222246405745257275088696311157297823662689037894645226208581)");
+
+    F2Element e2;
+    F2.fromString(e2, "(21888242871839275222246405745257275088696311157297823662689037894645226208580,7)");
+
+    F2Element e3;
+    F2.mul(e3, e1, e2);
+
+    F1Element t0, t1;
+    F2Element e33;
+    F1.mul(t0, e1.a, e2.a);
+    F1.mul(t1, e1.b, e2.b);
+    F1.sub(e33.a, t0, t1);
+    F1.mul(t0, e1.a, e2.b);
+    F1.mul(t1, e1.b, e2.a);
+    F1.add(e33.b, t0, t1);
+
+    ASSERT_TRUE(F2.eq(e3, e33));
+
+    F2.square(e3, e3);
+    F2.square(e33, e33);
+    ASSERT_TRUE(F2.eq(e3, e33));
+}
+
+TEST(altBn128, runtimeParamsFallback) {
+    Curve<RawFq> G1r(F1, "0", "3", "1", "2");
+    F2Field<RawFq> F2r("-1");
+
+    G1Point p1, p2;
+    G1.dbl(p1, G1.one());
+    G1.add(p1, p1, G1.oneAffine());
+    G1.dbl(p1, p1);
+
+    Curve<RawFq>::Point pr;
+    G1r.dbl(pr, G1r.one());
+    G1r.add(pr, pr, G1r.oneAffine());
+    G1r.dbl(pr, pr);
+
+    G1.copy(p2, G1.zero());
+    F1.copy(p2.x, pr.x);
+    F1.copy(p2.y, pr.y);
+    F1.copy(p2.zz, pr.zz);
+    F1.copy(p2.zzz, pr.zzz);
+    ASSERT_TRUE(G1.eq(p1, p2));
+
+    F2Element e1, e2, e3;
+    F2.fromString(e1, "(5,7)");
+    F2.fromString(e2, "(11,13)");
+    F2.mul(e3, e1, e2);
+    F2.square(e3, e3);
+
+    F2Field<RawFq>::Element r1, r2, r3;
+    F2r.fromString(r1, "(5,7)");
+    F2r.fromString(r2, "(11,13)");
+    F2r.mul(r3, r1, r2);
+    F2r.square(r3, r3);
+
+    ASSERT_TRUE(F1.eq(e3.a, r3.a));
+    ASSERT_TRUE(F1.eq(e3.b, r3.b));
+}
+
+TEST(altBn128, traitsMismatch) {
+    // The compile time a of G1Type and non residue of F2Type are checked at construction
+    ASSERT_THROW(G1Type(F1, "1", "3", "1", "2"), std::invalid_argument);
+    ASSERT_THROW(F2Type("5"), std::invalid_argument);
+    ASSERT_NO_THROW(G1Type(F1, "0", "3", "1", "2"));
+    ASSERT_NO_THROW(F2Type("-1"));
+    ASSERT_NO_THROW((Curve<RawFq>(F1, "1", "3", "1", "2")));
+}
+
 TEST(altBn128, g1_PlusZero) {
     G1Point p1;
 
@@ -162,13 +237,110 @@ TEST(altBn128, g2_expToOrder) {
     mpz_export((void *)scalar, NULL, -1, 8, -1, 0, e);
     mpz_clear(e);
 
-    Curve<F2Field<RawFq>>::Point p1;
+    G2Point p1;
 
     G2.mulByScalar(p1, G2.one(), scalar, 32);
 
     ASSERT_TRUE(G2.isZero(p1));
 }
 
+TEST(altBn128, backends) {
+    int fqBackend = Fq_getBackend();
+    int frBackend = Fr_getBackend();
+
+    uint8_t scalar[32];
+    for (int i=0;i<32;i++) scalar[i] = 0x5A + 3*i;
+
+    G1Point p[3];
+    G2Point p2[3];
+    AltBn128::FrElement e[3];
+    bool supported[3];
+
+    for (int b=Fq_BACKEND_ADX; b<=Fq_BACKEND_CPP; b++) {
+        supported[b] = Fq_setBackend(b);
+        if (!supported[b]) continue;
+        ASSERT_TRUE(Fr_setBackend(b));
+
+        G1.mulByScalar(p[b], G1.one(), scalar, 32);
+        G1.add(p[b], p[b], G1.oneAffine());
+        G2.mulByScalar(p2[b], G2.one(), scalar, 32);
+        Fr.fromString(e[b], "12345678901234567890123456789");
+        Fr.mul(e[b], e[b], e[b]);
+    }
+
+    Fq_setBackend(fqBackend);
+    Fr_setBackend(frBackend);
+
+    ASSERT_TRUE(supported[Fq_BACKEND_MUL]);
+    ASSERT_TRUE(supported[Fq_BACKEND_CPP]);
+    // bn128 q and r are not 2^256 - c
+    ASSERT_FALSE(Fq_setBackend(Fq_BACKEND_SPECIAL));
+    ASSERT_FALSE(Fr_setBackend(Fr_BACKEND_SPECIAL));
+    // The 4 limb fields only have the CIOS multiplication
+    ASSERT_EQ(Fq_getMulStrategy(), Fq_MULSTRATEGY_CIOS);
+    ASSERT_FALSE(Fq_setMulStrategy(Fq_MULSTRATEGY_BLOCKED));
+    ASSERT_FALSE(Fq_setMulStrategy(Fq_MULSTRATEGY_KARATSUBA));
+    for (int b=Fq_BACKEND_MUL; b<=Fq_BACKEND_CPP; b++) {
+        ASSERT_TRUE(G1.eq(p[b], p[Fq_BACKEND_MUL]));
+        ASSERT_TRUE(G2.eq(p2[b], p2[Fq_BACKEND_MUL]));
+        ASSERT_TRUE(Fr.eq(e[b], e[Fq_BACKEND_MUL]));
+        if (supported[Fq_BACKEND_ADX]) {
+            ASSERT_TRUE(G1.eq(p[b], p[Fq_BACKEND_ADX]));
+            ASSERT_TRUE(G2.eq(p2[b], p2[Fq_BACKEND_ADX]));
+            ASSERT_TRUE(Fr.eq(e[b], e[Fq_BACKEND_ADX]));
+        }
+    }
+}
+
+// The Element functions call the dispatched ones from the assembly, with short, long and
+// Montgomery operands
+TEST(altBn128, backendsElementApi) {
+    int frBackend = Fr_getBackend();
+
+    const int nRes = 8;
+    ::FrElement r[3][nRes];
+    bool supported[3];
+
+    for (int b=Fr_BACKEND_ADX; b<=Fr_BACKEND_CPP; b++) {
+        supported[b] = Fr_setBackend(b);
+        if (!supported[b]) continue;
+
+        ::FrElement s1 = {5, Fr_SHORT, {0}};
+        ::FrElement s2 = {-3, Fr_SHORT, {0}};
+        ::FrElement l1, m1;
+        Fr_toLongNormal(&l1, &s2);
+        Fr_mul(&l1, &l1, &s1);
+        Fr_toMontgomery(&m1, &s2);
+
+        Fr_mul(&r[b][0], &s1, &s2);
+        Fr_copy(&r[b][1], &m1);
+        Fr_toMontgomery(&r[b][2], &l1);
+        Fr_mul(&r[b][3], &s1, &l1);
+        Fr_mul(&r[b][4], &l1, &s2);
+        Fr_mul(&r[b][5], &r[b][2], &l1);
+        Fr_mul(&r[b][6], &m1, &r[b][2]);
+        Fr_toNormal(&r[b][7], &r[b][6]);
+        for (int i=0; i<nRes; i++) Fr_toLongNormal(&r[b][i], &r[b][i]);
+    }
+
+    Fr_setBackend(frBackend);
+
+    ::FrElement e = {-15, Fr_SHORT, {0}};
+    Fr_toLongNormal(&e, &e);
+    ASSERT_EQ(memcmp(r[Fr_BACKEND_MUL][0].longVal, e.longVal, sizeof(FrRawElement)), 0);
+    e.shortVal = -3;
+    e.type = Fr_SHORT;
+    Fr_toLongNormal(&e, &e);
+    ASSERT_EQ(memcmp(r[Fr_BACKEND_MUL][1].longVal, e.longVal, sizeof(FrRawElement)), 0);
+
+    for (int b=Fr_BACKEND_ADX; b<=Fr_BACKEND_CPP; b++) {
+        if (!supported[b]) continue;
+        for (int i=0; i<nRes; i++) {
+            ASSERT_EQ(memcmp(r[b][i].longVal, r[Fr_BACKEND_MUL][i].longVal, sizeof(FrRawElement)), 0);
+        }
+    }
+}
+
 TEST(altBn128, multiExp) {
 
     int NMExp = 40000;
@@ -270,6 +442,886 @@ TEST(altBn128, fft) {
     delete[] a;
 }
 
+TEST(altBn128, fftSixStep) {
+    // Big enough for fftSixStep, with an odd and an even log2
+    for (int lg=13; lg<=14; lg++) {
+        u_int64_t n = 1 << lg;
+        AltBn128::FrElement *a = new AltBn128::FrElement[n];
+        AltBn128::FrElement *b = new AltBn128::FrElement[n];
+        for (u_int64_t i=0; i<n; i++) {
+            Fr.fromUI(a[i], i*i + 7);
+            Fr.copy(b[i], a[i]);
+        }
+
+        FFT<typename Engine::Fr> fft(n);
+        fft.fft(b, n);
+
+        // b[k] = a(w^k)
+        u_int64_t ks[4] = {0, 1, n/2 + 3, n-1};
+        for (int t=0; t<4; t++) {
+            AltBn128::FrElement x = fft.root(lg, ks[t]);
+            AltBn128::FrElement v = Fr.zero();
+            for (int64_t i=n-1; i>=0; i--) v = Fr.add(Fr.mul(v, x), a[i]);
+            ASSERT_TRUE(Fr.eq(b[ks[t]], v));
+        }
+
+        fft.ifft(b, n);
+        for (u_int64_t i=0; i<n; i++) ASSERT_TRUE(Fr.eq(b[i], a[i]));
+
+        delete[] a;
+        delete[] b;
+    }
+}
+
+TEST(altBn128, fftNoBitReversal) {
+    // 2^14 also has stages bigger than a cache block
+    for (int lg=10; lg<=14; lg+=4) {
+        u_int64_t n = 1 << lg;
+        AltBn128::FrElement *a = new AltBn128::FrElement[n];
+        AltBn128::FrElement *b = new AltBn128::FrElement[n];
+        AltBn128::FrElement *c = new AltBn128::FrElement[n];
+        AltBn128::FrElement *d = new AltBn128::FrElement[n];
+        for (u_int64_t i=0; i<n; i++) {
+            Fr.fromUI(a[i], i*i + 7);
+            Fr.copy(b[i], a[i]);
+            // c has degree < n/2 so a*c mod x^n - 1 is checked on the low half
+            if (i < n/2) Fr.fromUI(c[i], 3*i + 1); else Fr.copy(c[i], Fr.zero());
+            Fr.copy(d[i], c[i]);
+        }
+
+        FFT<typename Engine::Fr> fft(n);
+        fft.fft(a, n);
+        fft.fftDIF(b, n);
+        for (u_int64_t i=0; i<n; i++) {
+            u_int64_t r = 0;
+            for (int k=0; k<lg; k++) r |= ((i >> k) & 1) << (lg-1-k);
+            ASSERT_TRUE(Fr.eq(b[i], a[r]));
+        }
+
+        // ifft(fft(a)*fft(c)) both ways
+        fft.fft(c, n);
+        fft.fftDIF(d, n);
+        for (u_int64_t i=0; i<n; i++) {
+            a[i] = Fr.mul(a[i], c[i]);
+            b[i] = Fr.mul(b[i], d[i]);
+        }
+        fft.ifft(a, n);
+        fft.ifftDIT(b, n);
+        for (u_int64_t i=0; i<n; i++) ASSERT_TRUE(Fr.eq(b[i], a[i]));
+
+        delete[] a;
+        delete[] b;
+        delete[] c;
+        delete[] d;
+    }
+}
+
+TEST(altBn128, cosetFft) {
+    AltBn128::FrElement shift;
+    Fr.fromUI(shift, 7);
+    // In the cache and through fftSixStep
+    for (int lg=10; lg<=14; lg+=4) {
+        u_int64_t n = 1 << lg;
+        AltBn128::FrElement *a = new AltBn128::FrElement[n];
+        AltBn128::FrElement *b = new AltBn128::FrElement[n];
+        for (u_int64_t i=0; i<n; i++) {
+            Fr.fromUI(a[i], i*i + 7);
+            Fr.copy(b[i], a[i]);
+        }
+
+        FFT<typename Engine::Fr> fft(n*4);
+        fft.cosetFft(b, n, shift);
+
+        // b[k] = a(shift*w^k)
+        u_int64_t ks[4] = {0, 1, n/2 + 3, n-1};
+        for (int t=0; t<4; t++) {
+            AltBn128::FrElement x = Fr.mul(shift, fft.root(lg, ks[t]));
+            AltBn128::FrElement v = Fr.zero();
+            for (int64_t i=n-1; i>=0; i--) v = Fr.add(Fr.mul(v, x), a[i]);
+            ASSERT_TRUE(Fr.eq(b[ks[t]], v));
+        }
+
+        fft.cosetIfft(b, n, shift);
+        for (u_int64_t i=0; i<n; i++) ASSERT_TRUE(Fr.eq(b[i], a[i]));
+
+        // a has the values on the subgroup of the polynomial with coefficients b
+        AltBn128::FrElement *e = new AltBn128::FrElement[n*4];
+        fft.fft(a, n);
+        fft.lde(e, a, n, 4, shift);
+        for (int t=0; t<4; t++) {
+            u_int64_t k = ks[t]*4 + t;
+            AltBn128::FrElement x = Fr.mul(shift, fft.root(lg+2, k));
+            AltBn128::FrElement v = Fr.zero();
+            for (int64_t i=n-1; i>=0; i--) v = Fr.add(Fr.mul(v, x), b[i]);
+            ASSERT_TRUE(Fr.eq(e[k], v));
+        }
+
+        // More shifts than the cached tables, and back to the first one once it is evicted
+        for (u_int64_t i=0; i<n; i++) Fr.fromUI(a[i], i*i + 7);
+        for (int t=0; t<10; t++) {
+            AltBn128::FrElement sh;
+            Fr.fromUI(sh, t < 9 ? 7 + t : 7);
+            for (u_int64_t i=0; i<n; i++) Fr.copy(e[i], a[i]);
+            fft.cosetFft(e, n, sh);
+            if (t == 0) for (u_int64_t i=0; i<n; i++) { Fr.copy(b[i], e[i]); }
+            if (t == 9) for (u_int64_t i=0; i<n; i++) { ASSERT_TRUE(Fr.eq(e[i], b[i])); }
+            fft.cosetIfft(e, n, sh);
+            for (u_int64_t i=0; i<n; i++) ASSERT_TRUE(Fr.eq(e[i], a[i]));
+        }
+
+        delete[] a;
+        delete[] b;
+        delete[] e;
+    }
+}
+
+TEST(altBn128, fftPolys) {
+    const int nPolys = 3;
+    AltBn128::FrElement shift;
+    Fr.fromUI(shift, 7);
+    for (int lg=10; lg<=14; lg+=4) {
+        u_int64_t n = 1 << lg;
+        AltBn128::FrElement *a[nPolys];
+        AltBn128::FrElement *b[nPolys];
+        for (int p=0; p<nPolys; p++) {
+            a[p] = new AltBn128::FrElement[n];
+            b[p] = new AltBn128::FrElement[n];
+            for (u_int64_t i=0; i<n; i++) {
+                Fr.fromUI(a[p][i], i*i + 7*p + 1);
+                Fr.copy(b[p][i], a[p][i]);
+            }
+        }
+
+        // Same results as one polynomial at a time
+        FFT<typename Engine::Fr> fft(n);
+        fft.ifft(b, nPolys, n);
+        fft.cosetFft(b, nPolys, n, shift);
+        for (int p=0; p<nPolys; p++) {
+            fft.ifft(a[p], n);
+            fft.cosetFft(a[p], n, shift);
+            for (u_int64_t i=0; i<n; i++) ASSERT_TRUE(Fr.eq(b[p][i], a[p][i]));
+        }
+
+        fft.cosetIfft(b, nPolys, n, shift);
+        fft.fft(b, nPolys, n);
+        for (int p=0; p<nPolys; p++) {
+            for (u_int64_t i=0; i<n; i++) {
+                AltBn128::FrElement e;
+                Fr.fromUI(e, i*i + 7*p + 1);
+                ASSERT_TRUE(Fr.eq(b[p][i], e));
+            }
+            delete[] a[p];
+            delete[] b[p];
+        }
+    }
+}
+
+TEST(altBn128, fftRoots) {
+    typedef typename Engine::Fr RawFr;
+    const u_int64_t n = 1 << 12;
+    AltBn128::FrElement *a = new AltBn128::FrElement[n];
+    AltBn128::FrElement *b = new AltBn128::FrElement[n];
+    for (u_int64_t i=0; i<n; i++) Fr.fromUI(a[i], i*i + 7);
+
+    // A small domain uses the table of a bigger one, with the same roots
+    FFT<RawFr> *big = new FFT<RawFr>(n*4);
+    FFT<RawFr> small(n);
+    for (u_int64_t i=0; i<n; i++) ASSERT_TRUE(Fr.eq(small.root(12, i), big->root(12, i)));
+    for (int lg=1; lg<=14; lg++) ASSERT_TRUE(Fr.eq(big->root(lg, (u_int64_t)1 << (lg-1)), Fr.negOne()));
+
+    // The small one keeps working after the big one and the registry let the table go
+    delete big;
+    FFTRoots<RawFr>::clear();
+    for (u_int64_t i=0; i<n; i++) Fr.copy(b[i], a[i]);
+    small.fft(b, n);
+    small.ifft(b, n);
+    for (u_int64_t i=0; i<n; i++) ASSERT_TRUE(Fr.eq(b[i], a[i]));
+
+    // Computed and saved, then mapped from the file
+    std::string fileName = testing::TempDir() + "fft_roots_test.bin";
+    unlink(fileName.c_str());
+    FFTRoots<RawFr>::setFile(fileName);
+    AltBn128::FrElement r[2];
+    for (int t=0; t<2; t++) {
+        FFTRoots<RawFr>::clear();
+        FFT<RawFr> fft(n);
+        for (u_int64_t i=0; i<n; i++) Fr.copy(b[i], a[i]);
+        fft.fft(b, n);
+        Fr.copy(r[t], b[n/2 + 3]);
+        fft.ifft(b, n);
+        for (u_int64_t i=0; i<n; i++) ASSERT_TRUE(Fr.eq(b[i], a[i]));
+        ASSERT_EQ(access(fileName.c_str(), R_OK), 0);
+    }
+    ASSERT_TRUE(Fr.eq(r[0], r[1]));
+    FFTRoots<RawFr>::setFile("");
+    FFTRoots<RawFr>::clear();
+    unlink(fileName.c_str());
+
+    delete[] a;
+    delete[] b;
+}
+
+TEST(altBn128, fftCompressedRoots) {
+    typedef typename Engine::Fr RawFr;
+    AltBn128::FrElement shift;
+    Fr.fromUI(shift, 7);
+    // In the cache, six step and the big DIF/DIT passes
+    for (int lg=11; lg<=15; lg+=4) {
+        u_int64_t n = 1 << lg;
+        AltBn128::FrElement *a[4];
+        for (int t=0; t<4; t++) {
+            a[t] = new AltBn128::FrElement[n];
+            for (u_int64_t i=0; i<n; i++) Fr.fromUI(a[t][i], i*i + 7);
+        }
+
+        FFT<RawFr> full(n);
+        full.cosetFft(a[0], n, shift);
+        full.fftDIF(a[1], n);
+
+        FFTRoots<RawFr>::setCompressed(true);
+        FFTRoots<RawFr>::clear();
+        FFT<RawFr> compressed(n);
+        FFTRoots<RawFr>::setCompressed(false);
+        FFTRoots<RawFr>::clear();
+
+        for (u_int64_t i=0; i<n; i++) ASSERT_TRUE(Fr.eq(compressed.root(lg, i), full.root(lg, i)));
+        compressed.cosetFft(a[2], n, shift);
+        compressed.fftDIF(a[3], n);
+        for (u_int64_t i=0; i<n; i++) {
+            ASSERT_TRUE(Fr.eq(a[2][i], a[0][i]));
+            ASSERT_TRUE(Fr.eq(a[3][i], a[1][i]));
+        }
+        compressed.ifftDIT(a[3], n);
+        for (u_int64_t i=0; i<n; i++) {
+            AltBn128::FrElement e;
+            Fr.fromUI(e, i*i + 7);
+            ASSERT_TRUE(Fr.eq(a[3][i], e));
+        }
+
+        for (int t=0; t<4; t++) delete[] a[t];
+    }
+}
+
+TEST(altBn128, fftRecursive) {
+    for (int lg=10; lg<=16; lg+=6) {
+        u_int64_t n = 1 << lg;
+        AltBn128::FrElement *a = new AltBn128::FrElement[n];
+        AltBn128::FrElement *b = new AltBn128::FrElement[n];
+        AltBn128::FrElement *c = new AltBn128::FrElement[n];
+        for (u_int64_t i=0; i<n; i++) {
+            Fr.fromUI(a[i], i*i + 7);
+            Fr.copy(b[i], a[i]);
+            Fr.copy(c[i], a[i]);
+        }
+
+        FFT<typename Engine::Fr> fft(n);
+        fft.fft(a, n);
+        fft.fftRecursive(b, n);
+        for (u_int64_t i=0; i<n; i++) ASSERT_TRUE(Fr.eq(b[i], a[i]));
+
+        // Two at the same time on the threads of one region
+        for (u_int64_t i=0; i<n; i++) Fr.fromUI(b[i], i*i + 7);
+        #pragma omp parallel
+        #pragma omp single
+        {
+            #pragma omp task
+            fft.fftRecursive(b, n);
+            #pragma omp task
+            fft.fftRecursive(c, n);
+        }
+        for (u_int64_t i=0; i<n; i++) {
+            ASSERT_TRUE(Fr.eq(b[i], a[i]));
+            ASSERT_TRUE(Fr.eq(c[i], a[i]));
+        }
+
+        delete[] a;
+        delete[] b;
+        delete[] c;
+    }
+}
+
+TEST(altBn128, fftOutOfCore) {
+    // 64KB of buffers: 512 elements each, so every pass takes several blocks
+    const u_int64_t maxMemory = 1 << 16;
+    std::string fileName = testing::TempDir() + "fft_out_of_core_test.bin";
+    for (int lg=13; lg<=14; lg++) {
+        u_int64_t n = 1 << lg;
+        AltBn128::FrElement *a = new AltBn128::FrElement[n];
+        AltBn128::FrElement *b = new AltBn128::FrElement[n];
+        for (u_int64_t i=0; i<n; i++) {
+            Fr.fromUI(a[i], i*i + 7);
+            Fr.copy(b[i], a[i]);
+        }
+
+        FFT<typename Engine::Fr> fft(n);
+        int fd = open(fileName.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0600);
+        ASSERT_GE(fd, 0);
+        ASSERT_EQ(write(fd, a, n*sizeof(AltBn128::FrElement)), (ssize_t)(n*sizeof(AltBn128::FrElement)));
+        fft.fftOutOfCore(fd, n, maxMemory);
+        fft.fftOutOfCore(b, n, maxMemory);
+        fft.fft(a, n);
+        for (u_int64_t i=0; i<n; i++) ASSERT_TRUE(Fr.eq(b[i], a[i]));
+        ASSERT_EQ(pread(fd, b, n*sizeof(AltBn128::FrElement), 0), (ssize_t)(n*sizeof(AltBn128::FrElement)));
+        for (u_int64_t i=0; i<n; i++) ASSERT_TRUE(Fr.eq(b[i], a[i]));
+
+        ASSERT_THROW(fft.fftOutOfCore(fd, n, 1 << 10), std::invalid_argument);
+        ASSERT_EQ(ftruncate(fd, n*sizeof(AltBn128::FrElement)/2), 0);
+        ASSERT_THROW(fft.fftOutOfCore(fd, n, maxMemory), std::system_error);
+        close(fd);
+
+        delete[] a;
+        delete[] b;
+    }
+    unlink(fileName.c_str());
+}
+
+// fft -> product -> ifft against the cyclic convolution, which only holds for a transform with
+// a root of order n
+template <typename Field>
+void checkConvolution(FFT<Field> &fft, u_int64_t n) {
+    Field &F = Field::field;
+    typename Field::Element *a = new typename Field::Element[n];
+    typename Field::Element *b = new typename Field::Element[n];
+    typename Field::Element *c = new typename Field::Element[n];
+    for (u_int64_t i=0; i<n; i++) {
+        F.fromUI(a[i], i*i + 7);
+        F.fromUI(b[i], 3*i + 1);
+        F.copy(c[i], F.zero());
+    }
+    for (u_int64_t i=0; i<n; i++) {
+        for (u_int64_t j=0; j<n; j++) {
+            typename Field::Element e;
+            F.mul(e, a[i], b[j]);
+            F.add(c[(i+j) % n], c[(i+j) % n], e);
+        }
+    }
+    fft.fft(a, n);
+    fft.fft(b, n);
+    for (u_int64_t i=0; i<n; i++) F.mul(a[i], a[i], b[i]);
+    fft.ifft(a, n);
+    for (u_int64_t i=0; i<n; i++) ASSERT_TRUE(F.eq(a[i], c[i]));
+    delete[] a;
+    delete[] b;
+    delete[] c;
+}
+
+TEST(altBn128, fftMixedRadix) {
+    typedef typename Engine::Fr RawFr;
+    // r-1 has 3^2: radix 3 stages, with and without a power of two part
+    FFT<RawFr> fft(9 << 16);
+    u_int64_t sizes[] = { 3, 9, 9 << 5, 3 << 7 };
+    for (u_int64_t n : sizes) checkConvolution(fft, n);
+
+    // Round trip with the six step sub FFTs, a coset and the lde from 3*2^6 to 3*2^7 points
+    AltBn128::FrElement shift;
+    Fr.fromUI(shift, 7);
+    u_int64_t n = 3 << 16;
+    AltBn128::FrElement *a = new AltBn128::FrElement[2*n];
+    AltBn128::FrElement *b = new AltBn128::FrElement[2*n];
+    for (u_int64_t i=0; i<n; i++) Fr.fromUI(a[i], i*i + 7);
+    fft.fft(a, n);
+    fft.cosetIfft(a, n, shift);
+    fft.cosetFft(a, n, shift);
+    fft.ifft(a, n);
+    for (u_int64_t i=0; i<n; i++) {
+        AltBn128::FrElement e;
+        Fr.fromUI(e, i*i + 7);
+        ASSERT_TRUE(Fr.eq(a[i], e));
+    }
+    n = 3 << 6;
+    for (u_int64_t i=0; i<2*n; i++) Fr.fromUI(b[i], i < n ? i*i + 7 : 0);
+    fft.cosetFft(b, 2*n, shift);
+    for (u_int64_t i=0; i<n; i++) Fr.fromUI(a[i], i*i + 7);
+    fft.fft(a, n);
+    fft.lde(a, a, n, 2, shift);
+    for (u_int64_t i=0; i<2*n; i++) ASSERT_TRUE(Fr.eq(a[i], b[i]));
+    delete[] a;
+    delete[] b;
+
+    // 5 does not divide r-1
+    ASSERT_THROW(FFT<RawFr>(5 << 4).fft((AltBn128::FrElement *)NULL, 5 << 4), std::range_error);
+
+    // The largest mixed domain, 3*2^28, over the 2^28 roots of r-1 (two level tables, the full
+    // one does not fit in the memory of the test)
+    FFTRoots<RawFr>::setCompressed(true);
+    FFTRoots<RawFr>::clear();
+    FFT<RawFr> maxFft((u_int64_t)3 << 28);
+    FFTRoots<RawFr>::setCompressed(false);
+    FFTRoots<RawFr>::clear();
+    ASSERT_TRUE(Fr.eq(maxFft.root(28, (u_int64_t)1 << 27), Fr.negOne()));
+    checkConvolution(maxFft, 3 << 4);
+
+    // Goldilocks, radix 3 and 5
+    FFT<GoldilocksField> gfft(15 << 6);
+    checkConvolution(gfft, 15 << 6);
+    checkConvolution(gfft, 5);
+}
+
+TEST(altBn128, reversePermutation) {
+    // Below the tile size, no middle bits, and odd and even middle parts
+    int lgs[4] = {5, 12, 15, 16};
+    for (int t=0; t<4; t++) {
+        int lg = lgs[t];
+        u_int64_t n = 1 << lg;
+        AltBn128::FrElement *a = new AltBn128::FrElement[n];
+        for (u_int64_t i=0; i<n; i++) Fr.fromUI(a[i], i);
+
+        FFT<typename Engine::Fr> fft(2);
+        fft.reversePermutation(a, n);
+        for (u_int64_t i=0; i<n; i++) {
+            u_int64_t r = 0;
+            for (int k=0; k<lg; k++) r |= ((i >> k) & 1) << (lg-1-k);
+            AltBn128::FrElement e;
+            Fr.fromUI(e, r);
+            ASSERT_TRUE(Fr.eq(a[i], e));
+        }
+
+        delete[] a;
+    }
+}
+
+TEST(altBn128, goldilocks) {
+    typedef GoldilocksField::Element GElement;
+    GoldilocksField &G = GoldilocksField::field;
+    const int n = 37;
+    const int nFFT = 1<<7;
+
+    GElement a[n], b[n], r[n], t;
+    for (int i=0; i<n; i++) {
+        a[i].v = GoldilocksField::P - 1 - (uint64_t)i*i*0x9E3779B97F4A7C15ULL % GoldilocksField::P;
+        b[i].v = (uint64_t)i*0xD1B54A32D192ED03ULL % GoldilocksField::P;
+    }
+
+    const int simd = GoldilocksField::getSimd();
+    for (int level=GoldilocksField::SIMD_NONE; level<=GoldilocksField::cpuSimd(); level++) {
+        ASSERT_TRUE(GoldilocksField::setSimd(level));
+        G.addBatch(r, a, b, n);
+        for (int i=0; i<n; i++) ASSERT_TRUE(G.eq(r[i], G.add(a[i], b[i])));
+        G.subBatch(r, a, b, n);
+        for (int i=0; i<n; i++) ASSERT_TRUE(G.eq(r[i], G.sub(a[i], b[i])));
+        G.mulBatch(r, a, b, n);
+        for (int i=0; i<n; i++) ASSERT_TRUE(G.eq(r[i], G.mul(a[i], b[i])));
+    }
+
+    GElement *p = new GElement[nFFT];
+    GElement *e = new GElement[nFFT];
+    for (int i=0; i<nFFT; i++) G.fromUI(p[i], i*i + 1);
+
+    FFT<GoldilocksField> fft(nFFT);
+    for (int level=GoldilocksField::SIMD_NONE; level<=GoldilocksField::cpuSimd(); level++) {
+        ASSERT_TRUE(GoldilocksField::setSimd(level));
+        for (int i=0; i<nFFT; i++) G.copy(e[i], p[i]);
+        fft.fft(e, nFFT);
+
+        // e[k] = p(w^k)
+        GElement w = fft.root(fft.log2(nFFT), 1);
+        GElement x = G.one();
+        for (int k=0; k<nFFT; k++) {
+            GElement v = G.zero();
+            for (int i=nFFT-1; i>=0; i--) v = G.add(G.mul(v, x), p[i]);
+            ASSERT_TRUE(G.eq(e[k], v));
+            x = G.mul(x, w);
+        }
+
+        fft.ifft(e, nFFT);
+        for (int i=0; i<nFFT; i++) ASSERT_TRUE(G.eq(e[i], p[i]));
+    }
+    GoldilocksField::setSimd(simd);
+
+    G.inv(t, a[5]);
+    ASSERT_TRUE(G.eq(G.mul(t, a[5]), G.one()));
+
+    delete[] p;
+    delete[] e;
+}
+
+TEST(altBn128, fr_mulBatch) {
+    const int n = 37;
+
+    AltBn128::FrElement a[n], b[n], r[n], ref[n];
+
+    for (int i=0; i<n; i++) {
+        Fr.fromUI(a[i], i*i+7);
+        Fr.fromUI(b[i], 3*i+1);
+        Fr.mul(a[i], a[i], a[i]);
+        Fr.neg(b[i], b[i]);
+        Fr.mul(ref[i], a[i], b[i]);
+    }
+
+    Fr.mulBatch(r, a, b, n);
+    Fr.mulBatch(a, a, b, n);
+
+    uint64_t x[Fr_N52];
+    AltBn128::FrElement c;
+    for (int i=0; i<n; i++) {
+        ASSERT_TRUE(Fr.eq(r[i], ref[i]));
+        ASSERT_TRUE(Fr.eq(a[i], ref[i]));
+
+        Fr_rawToRadix52(x, b[i].v);
+        Fr_rawFromRadix52(c.v, x);
+        ASSERT_TRUE(Fr.eq(c, b[i]));
+    }
+}
+
+TEST(altBn128, dot) {
+    const int n = 300;
+
+    F1Element a[n], b[n], r, s, t, u;
+    for (int i=0; i<n; i++) {
+        F1.fromUI(a[i], i+1);
+        F1.fromUI(b[i], 7*i+5);
+        if (i%3 == 0) F1.neg(a[i], a[i]);
+        if (i%4 == 0) F1.neg(b[i], b[i]);
+    }
+
+    for (int len=0; len<=n; len += len < 20 ? 1 : 70) {
+        F1.copy(r, F1.zero());
+        F1.copy(s, F1.zero());
+        for (int i=0; i<len; i++) {
+            F1.mul(t, a[i], b[i]);
+            F1.add(r, r, t);
+            F1.add(s, s, a[i]);
+        }
+        F1.dot(u, a, b, len);
+        ASSERT_TRUE(F1.eq(u, r));
+        F1.sumN(u, a, len);
+        ASSERT_TRUE(F1.eq(u, s));
+    }
+
+    F1.mul(t, a[3], b[4]);
+    F1.add(t, t, a[5]);
+    F1.mulAdd(u, a[3], b[4], a[5]);
+    ASSERT_TRUE(F1.eq(u, t));
+}
+
+TEST(altBn128, inv) {
+    F1Element a, r, t;
+
+    F1.inv(r, F1.zero());
+    ASSERT_TRUE(F1.isZero(r));
+
+    F1.inv(r, F1.one());
+    ASSERT_TRUE(F1.eq(r, F1.one()));
+
+    F1.inv(r, F1.negOne());
+    ASSERT_TRUE(F1.eq(r, F1.negOne()));
+
+    F1.fromString(a, "21888242871839275222246405745257275088696311157297823662689037894645226208582");
+    for (int i=0; i<50; i++) {
+        F1.inv(r, a);
+        F1.mul(t, r, a);
+        ASSERT_TRUE(F1.eq(t, F1.one()));
+        F1.inv(t, r);
+        ASSERT_TRUE(F1.eq(t, a));
+        F1.square(a, a);
+        F1.add(a, a, F1.one());
+    }
+
+    AltBn128::FrElement b, s;
+    Fr.fromString(b, "12345678901234567890123456789");
+    Fr.inv(s, b);
+    Fr.mul(s, s, b);
+    ASSERT_TRUE(Fr.eq(s, Fr.one()));
+}
+
+TEST(altBn128, rawSwap) {
+    F1Element a, b, a0, b0;
+    F1.fromString(a, "21888242871839275222246405745257275088696311157297823662689037894645226208582");
+    F1.fromString(b, "12345678901234567890123456789012345678901234567890");
+    F1.copy(a0, a);
+    F1.copy(b0, b);
+
+    Fq_rawSwap(a.v, b.v);
+    ASSERT_TRUE(F1.eq(a, b0));
+    ASSERT_TRUE(F1.eq(b, a0));
+
+    F1.swap(a, b);
+    ASSERT_TRUE(F1.eq(a, a0));
+    ASSERT_TRUE(F1.eq(b, b0));
+
+    AltBn128::FrElement c, d, c0, d0;
+    Fr.fromString(c, "21888242871839275222246405745257275088548364400416034343698204186575808495616");
+    Fr.fromString(d, "98765432109876543210987654321");
+    Fr.copy(c0, c);
+    Fr.copy(d0, d);
+
+    Fr_rawSwap(c.v, d.v);
+    ASSERT_TRUE(Fr.eq(c, d0));
+    ASSERT_TRUE(Fr.eq(d, c0));
+}
+
+TEST(altBn128, batchInverse) {
+    const int n = 1000;
+
+    AltBn128::FrElement *a = new AltBn128::FrElement[n];
+    AltBn128::FrElement *r = new AltBn128::FrElement[n];
+    AltBn128::FrElement t;
+
+    for (int i=0; i<n; i++) {
+        if (i%97 == 3) {
+            Fr.copy(a[i], Fr.zero());
+        } else {
+            Fr.fromUI(a[i], i+1);
+            Fr.square(a[i], a[i]);
+        }
+    }
+
+    for (uint32_t nThreads=1; nThreads<=3; nThreads++) {
+        Fr.batchInverse(r, a, n, nThreads);
+        for (int i=0; i<n; i++) {
+            Fr.inv(t, a[i]);
+            ASSERT_TRUE(Fr.eq(r[i], t));
+        }
+    }
+
+    Fr.batchInverse(a, a, n);
+    for (int i=0; i<n; i++) ASSERT_TRUE(Fr.eq(a[i], r[i]));
+
+    delete[] a;
+    delete[] r;
+}
+
+TEST(altBn128, exp) {
+    AltBn128::FrElement a, r, t;
+    Fr.fromString(a, "1234567890123456789012345678901234567890");
+
+    uint8_t scalar[32];
+    for (int i=0; i<32; i++) scalar[i] = 0;
+
+    Fr.exp(r, a, scalar, 32);
+    ASSERT_TRUE(Fr.eq(r, Fr.one()));
+
+    // Small exponents against repeated products
+    Fr.copy(t, Fr.one());
+    for (int e=1; e<300; e++) {
+        Fr.mul(t, t, a);
+        scalar[0] = e & 0xFF;
+        scalar[1] = e >> 8;
+        Fr.exp(r, a, scalar, 32);
+        ASSERT_TRUE(Fr.eq(r, t));
+    }
+
+    // a^(r-1) = 1 and a^(r-2) = a^-1
+    mpz_t m;
+    mpz_init_set_str(m, "21888242871839275222246405745257275088548364400416034343698204186575808495616", 10);
+    for (int i=0; i<32; i++) scalar[i] = 0;
+    mpz_export((void *)scalar, NULL, -1, 8, -1, 0, m);
+    Fr.exp(r, a, scalar, 32);
+    ASSERT_TRUE(Fr.eq(r, Fr.one()));
+
+    mpz_sub_ui(m, m, 1);
+    mpz_export((void *)scalar, NULL, -1, 8, -1, 0, m);
+    mpz_clear(m);
+    Fr.exp(r, a, scalar, 32);
+    Fr.inv(t, a);
+    ASSERT_TRUE(Fr.eq(r, t));
+
+    Fr_rawInvFermat(r.v, a.v);
+    ASSERT_TRUE(Fr.eq(r, t));
+}
+
+TEST(altBn128, sqrt) {
+    F1Element a, r, t;
+    AltBn128::FrElement b, s, u;
+
+    ASSERT_EQ(F1.legendre(F1.zero()), 0);
+    ASSERT_EQ(F1.legendre(F1.one()), 1);
+    ASSERT_EQ(F1.legendre(F1.negOne()), -1);       // q = 3 mod 4
+    ASSERT_FALSE(F1.sqrt(r, F1.negOne()));
+    ASSERT_TRUE(F1.sqrt(r, F1.zero()));
+    ASSERT_TRUE(F1.isZero(r));
+
+    Fr.fromUI(b, 5);                               // Smallest non residue of Fr
+    ASSERT_EQ(Fr.legendre(b), -1);
+    ASSERT_FALSE(Fr.sqrt(s, b));
+    ASSERT_TRUE(Fr.sqrt(s, Fr.zero()));
+    ASSERT_TRUE(Fr.isZero(s));
+
+    F1.fromUI(a, 3);
+    Fr.fromUI(b, 3);
+    for (int i=0; i<50; i++) {
+        F1.square(t, a);
+        ASSERT_TRUE(F1.isSquare(t));
+        ASSERT_TRUE(F1.sqrt(r, t));
+        F1.square(r, r);
+        ASSERT_TRUE(F1.eq(r, t));
+        F1.mul(a, a, t);
+
+        Fr.square(u, b);
+        ASSERT_EQ(Fr.legendre(u), 1);
+        ASSERT_TRUE(Fr.sqrt(s, u));
+        Fr.square(s, s);
+        ASSERT_TRUE(Fr.eq(s, u));
+        Fr.mul(b, b, u);
+        Fr.add(b, b, Fr.one());
+    }
+
+    const int n = 40;
+    AltBn128::FrElement c[n], d[n];
+    bool found[n];
+    for (int i=0; i<n; i++) Fr.fromUI(c[i], i);
+    ASSERT_FALSE(Fr.sqrtBatch(d, c, n, found, 2));
+    for (int i=0; i<n; i++) {
+        ASSERT_EQ(found[i], Fr.isSquare(c[i]));
+        Fr.square(u, d[i]);
+        ASSERT_TRUE(found[i] ? Fr.eq(u, c[i]) : Fr.isZero(d[i]));
+    }
+}
+
+
+TEST(altBn128, f12_mulBy034) {
+    F12Element a;
+    F12.fromString(a, "((((1,2),(3,4),(5,6)),((7,8),(9,10),(11,12))))");
+
+    F2Element c0, c3, c4;
+    F2.fromString(c0, "(13,14)");
+    F2.fromString(c3, "(15,16)");
+    F2.fromString(c4, "(17,18)");
+
+    F12Element b;
+    F12.copy(b, F12.zero());
+    F2.copy(b.a.a, c0);
+    F2.copy(b.b.a, c3);
+    F2.copy(b.b.b, c4);
+
+    F12Element r1, r2;
+    F12.mul(r1, a, b);
+    F12.mulBy034(r2, a, c0, c3, c4);
+
+    ASSERT_TRUE(F12.eq(r1, r2));
+
+    F12Element ai;
+    F12.inv(ai, a);
+    F12.mul(r1, a, ai);
+
+    ASSERT_TRUE(F12.eq(r1, F12.one()));
+}
+
+TEST(altBn128, pairing_bilinearity) {
+    uint8_t s5[32], s7[32], s35[32];
+    for (int i=0; i<32; i++) s5[i] = s7[i] = s35[i] = 0;
+    s5[0] = 5;
+    s7[0] = 7;
+    s35[0] = 35;
+
+    G1Point p5;
+    G1PointAffine p5a;
+    G1.mulByScalar(p5, G1.one(), s5, 32);
+    G1.copy(p5a, p5);
+
+    G2Point q7;
+    G2PointAffine q7a;
+    G2.mulByScalar(q7, G2.one(), s7, 32);
+    G2.copy(q7a, q7);
+
+    F12Element e1, e35, e57;
+    Pairing.pairing(e1, G1.oneAffine(), G2.oneAffine());
+    Pairing.pairing(e57, p5a, q7a);
+
+    ASSERT_FALSE(F12.eq(e1, F12.one()));
+
+    F12.copy(e35, F12.one());
+    for (int i=0; i<35; i++) F12.mul(e35, e35, e1);
+
+    ASSERT_TRUE(F12.eq(e57, e35));
+
+    mpz_t e;
+    mpz_init_set_str(e, "21888242871839275222246405745257275088548364400416034343698204186575808495617", 10);
+    F12Element er;
+    F12.copy(er, F12.one());
+    for (int i=mpz_sizeinbase(e, 2)-1; i>=0; i--) {
+        F12.square(er, er);
+        if (mpz_tstbit(e, i)) F12.mul(er, er, e1);
+    }
+    mpz_clear(e);
+
+    ASSERT_TRUE(F12.eq(er, F12.one()));
+
+    G1PointAffine p[2];
+    G2PointAffine q[2];
+    G1Point p35;
+    G1.mulByScalar(p35, G1.one(), s35, 32);
+    G1.neg(p[0], p35);
+    G2.copy(q[0], G2.one());
+    G1.copy(p[1], p5a);
+    G2.copy(q[1], q7a);
+
+    ASSERT_TRUE(Pairing.pairingCheck(p, q, 2));
+
+    G1.copy(p[1], G1.one());
+    ASSERT_FALSE(Pairing.pairingCheck(p, q, 2));
+}
+
+TEST(altBn128, groth16_batchVerify) {
+    const int nPublic = 3;
+    const int nProofs = 5;
+
+    auto g1Mul = [](G1PointAffine &r, AltBn128::FrElement &s) {
+        AltBn128::FrElement n;
+        G1Point p;
+        Fr.fromMontgomery(n, s);
+        G1.mulByScalar(p, G1.one(), (uint8_t *)&n, 32);
+        G1.copy(r, p);
+    };
+    auto g2Mul = [](G2PointAffine &r, AltBn128::FrElement &s) {
+        AltBn128::FrElement n;
+        G2Point p;
+        Fr.fromMontgomery(n, s);
+        G2.mulByScalar(p, G2.one(), (uint8_t *)&n, 32);
+        G2.copy(r, p);
+    };
+
+    // Toxic waste of a fake setup
+    AltBn128::FrElement alpha, beta, gamma, delta, ic[nPublic+1];
+    Fr.fromUI(alpha, 11);
+    Fr.fromUI(beta, 13);
+    Fr.fromUI(gamma, 17);
+    Fr.fromUI(delta, 19);
+    for (int i=0; i<=nPublic; i++) Fr.fromUI(ic[i], 23 + i);
+
+    G1PointAffine vk_alpha1, IC[nPublic+1];
+    G2PointAffine vk_beta2, vk_gamma2, vk_delta2;
+    g1Mul(vk_alpha1, alpha);
+    g2Mul(vk_beta2, beta);
+    g2Mul(vk_gamma2, gamma);
+    g2Mul(vk_delta2, delta);
+    for (int i=0; i<=nPublic; i++) g1Mul(IC[i], ic[i]);
+
+    typedef Groth16::BatchVerifier<Engine> Verifier;
+    Verifier::Proof proofs[nProofs];
+    AltBn128::FrElement pubs[nProofs*nPublic];
+
+    // A*B = alpha*beta + L*gamma + C*delta
+    for (int j=0; j<nProofs; j++) {
+        AltBn128::FrElement l, s, c, tmp, ea;
+        Fr.copy(l, ic[0]);
+        for (int i=0; i<nPublic; i++) {
+            Fr.fromUI(pubs[j*nPublic + i], j*10 + i + 1);
+            Fr.mul(tmp, pubs[j*nPublic + i], ic[i+1]);
+            Fr.add(l, l, tmp);
+        }
+        Fr.fromUI(s, j + 2);
+        Fr.fromUI(c, j + 100);
+        Fr.mul(ea, alpha, beta);
+        Fr.mul(tmp, l, gamma);
+        Fr.add(ea, ea, tmp);
+        Fr.mul(tmp, c, delta);
+        Fr.add(ea, ea, tmp);
+        Fr.div(ea, ea, s);
+        g1Mul(proofs[j].A, ea);
+        g2Mul(proofs[j].B, s);
+        g1Mul(proofs[j].C, c);
+    }
+
+    Verifier verifier(Engine::engine, Pairing, vk_alpha1, vk_beta2, vk_gamma2, vk_delta2, IC, nPublic);
+
+    ASSERT_TRUE(verifier.verify(proofs, pubs, 1));
+    ASSERT_TRUE(verifier.verify(proofs, pubs, nProofs));
+
+    Fr.add(pubs[3*nPublic + 1], pubs[3*nPublic + 1], Fr.one());
+    ASSERT_FALSE(verifier.verify(proofs, pubs, nProofs));
+    ASSERT_TRUE(verifier.verify(proofs, pubs, 3));
+}
 
 }  // namespace
 
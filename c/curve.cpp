@@ -1,13 +1,15 @@
 #include <sstream>
+#include <stdexcept>
+#include "assert.h"
 
-template <typename BaseField>
-Curve<BaseField>::Curve(BaseField &aF, typename BaseField::Element &aa, typename BaseField::Element &ab, typename BaseField::Element &agx, typename BaseField::Element &agy) : F(aF) {
+template <typename BaseField, typename Traits>
+Curve<BaseField, Traits>::Curve(BaseField &aF, typename BaseField::Element &aa, typename BaseField::Element &ab, typename BaseField::Element &agx, typename BaseField::Element &agy) : F(aF) {
     F = aF;
     initCurve(aa, ab, agx, agy);
 }
 
-template <typename BaseField>
-Curve<BaseField>::Curve(BaseField &aF, std::string as, std::string bs, std::string gxs, std::string gys) : F(aF) {
+template <typename BaseField, typename Traits>
+Curve<BaseField, Traits>::Curve(BaseField &aF, std::string as, std::string bs, std::string gxs, std::string gys) : F(aF) {
     F = aF;
 
     typename BaseField::Element aa;
@@ -24,8 +26,8 @@ Curve<BaseField>::Curve(BaseField &aF, std::string as, std::string bs, std::stri
 }
 
 
-template <typename BaseField>
-void Curve<BaseField>::initCurve(typename BaseField::Element &aa, typename BaseField::Element &ab, typename BaseField::Element &agx, typename BaseField::Element &agy) {
+template <typename BaseField, typename Traits>
+void Curve<BaseField, Traits>::initCurve(typename BaseField::Element &aa, typename BaseField::Element &ab, typename BaseField::Element &agx, typename BaseField::Element &agy) {
     F.copy(fa, aa);
     F.copy(fb, ab);
     F.copy(fone.x, agx);
@@ -42,13 +44,16 @@ void Curve<BaseField>::initCurve(typename BaseField::Element &aa, typename BaseF
     F.copy(fzero.zzz, F.zero());
 
     if (F.isZero(fa)) {
-        typeOfA = a_is_zero;
+        typeOfA = param_zero;
     } else if (F.eq(fa, F.one())) {
-        typeOfA = a_is_one;
+        typeOfA = param_one;
     } else if (F.eq(fa, F.negOne())) {
-        typeOfA = a_is_negone;
+        typeOfA = param_negone;
     } else {
-        typeOfA = a_is_long;
+        typeOfA = param_long;
+    }
+    if ((Traits::A != param_runtime)&&(Traits::A != typeOfA)) {
+        throw std::invalid_argument("Curve: a does not match the type of a of the traits");
     }
 
 #ifdef COUNT_OPS
@@ -57,13 +62,13 @@ void Curve<BaseField>::initCurve(typename BaseField::Element &aa, typename BaseF
 
 }
 
-template <typename BaseField>
-void inline Curve<BaseField>::mulByA(typename BaseField::Element &r, typename BaseField::Element &ab) {
-    switch (typeOfA) {
-        case a_is_zero: F.copy(r, F.zero()); break;
-        case a_is_one: F.copy(r, ab); break;
-        case a_is_negone: F.neg(r, ab); break;
-        case a_is_long: F.mul(r, fa, ab);
+template <typename BaseField, typename Traits>
+void inline Curve<BaseField, Traits>::mulByA(typename BaseField::Element &r, typename BaseField::Element &ab) {
+    switch (aType()) {
+        case param_zero: F.copy(r, F.zero()); break;
+        case param_one: F.copy(r, ab); break;
+        case param_negone: F.neg(r, ab); break;
+        default: F.mul(r, fa, ab);
     }
 }
 
@@ -85,8 +90,8 @@ void inline Curve<BaseField>::mulByA(typename BaseField::Element &r, typename Ba
     ZZ3 = ZZ1*ZZ2*PP
     ZZZ3 = ZZZ1*ZZZ2*PPP
 */
-template <typename BaseField>
-void Curve<BaseField>::add(Point &p3, Point &p1, Point &p2) {
+template <typename BaseField, typename Traits>
+void Curve<BaseField, Traits>::add(Point &p3, Point &p1, Point &p2) {
 #ifdef COUNT_OPS
     cntAdd++;
 #endif // COUNT_OPS
@@ -101,6 +106,11 @@ void Curve<BaseField>::add(Point &p3, Point &p1, Point &p2) {
         return;
     }
 
+    if (PointKernels<BaseField>::available) {
+        if (PointKernels<BaseField>::add(F, p3, p1, p2)) dbl(p3, p1);
+        return;
+    }
+
     typename BaseField::Element tmp;
 
     // U1 = X1*ZZ2
@@ -179,8 +189,8 @@ void Curve<BaseField>::add(Point &p3, Point &p1, Point &p2) {
     ZZZ3 = ZZZ1*PPP
 */
 
-template <typename BaseField>
-void Curve<BaseField>::add(Point &p3, Point &p1, PointAffine &p2) {
+template <typename BaseField, typename Traits>
+void Curve<BaseField, Traits>::add(Point &p3, Point &p1, PointAffine &p2) {
 #ifdef COUNT_OPS
     cntAddMixed++;
 #endif // COUNT_OPS
@@ -196,6 +206,11 @@ void Curve<BaseField>::add(Point &p3, Point &p1, PointAffine &p2) {
         return;
     }
 
+    if (PointKernels<BaseField>::available) {
+        if (PointKernels<BaseField>::addMixed(F, p3, p1, p2)) dbl(p3, p2);
+        return;
+    }
+
     typename BaseField::Element tmp;
 
     // U2 = X2*ZZ1
@@ -260,8 +275,8 @@ void Curve<BaseField>::add(Point &p3, Point &p1, PointAffine &p2) {
     ZZ3 = PP
     ZZZ3 = PPP
 */
-template <typename BaseField>
-void Curve<BaseField>::add(Point &p3, PointAffine &p1, PointAffine &p2) {
+template <typename BaseField, typename Traits>
+void Curve<BaseField, Traits>::add(Point &p3, PointAffine &p1, PointAffine &p2) {
 #ifdef COUNT_OPS
     cntAddAffine++;
 #endif // COUNT_OPS
@@ -334,8 +349,8 @@ void Curve<BaseField>::add(Point &p3, PointAffine &p1, PointAffine &p2) {
     ZZZ3 = W*ZZZ1
 
 */
-template <typename BaseField>
-void Curve<BaseField>::dbl(Point &p3, Point &p1) {
+template <typename BaseField, typename Traits>
+void Curve<BaseField, Traits>::dbl(Point &p3, Point &p1) {
 #ifdef COUNT_OPS
     cntDbl++;
 #endif // COUNT_OPS
@@ -346,6 +361,11 @@ void Curve<BaseField>::dbl(Point &p3, Point &p1) {
         return;
     }
 
+    if (PointKernels<BaseField>::available && (aType() == param_zero)) {
+        PointKernels<BaseField>::dblA0(F, p3, p1);
+        return;
+    }
+
     typename BaseField::Element tmp;
 
     // U = 2*Y1
@@ -369,7 +389,7 @@ void Curve<BaseField>::dbl(Point &p3, Point &p1) {
     F.square(M, p1.x);
     F.add(tmp, M, M);
     F.add(M, M, tmp);
-    if (typeOfA != a_is_zero) {
+    if (aType() != param_zero) {
         F.square(tmp, p1.zz);
         mulByA(tmp, tmp);
         F.add(M, M, tmp);
@@ -405,8 +425,8 @@ void Curve<BaseField>::dbl(Point &p3, Point &p1) {
     ZZ3 = V
     ZZZ3 = W
 */
-template <typename BaseField>
-void Curve<BaseField>::dbl(Point &p3, PointAffine &p1) {
+template <typename BaseField, typename Traits>
+void Curve<BaseField, Traits>::dbl(Point &p3, PointAffine &p1) {
 #ifdef COUNT_OPS
     cntDblMixed++;
 #endif // COUNT_OPS
@@ -455,8 +475,8 @@ void Curve<BaseField>::dbl(Point &p3, PointAffine &p1) {
     // ZZZ3 = W ; Already stored
 }     
 
-template <typename BaseField>
-bool Curve<BaseField>::eq(Point &p1, Point &p2) {
+template <typename BaseField, typename Traits>
+bool Curve<BaseField, Traits>::eq(Point &p1, Point &p2) {
 #ifdef COUNT_OPS
     cntEq++;
 #endif // COUNT_OPS
@@ -491,8 +511,8 @@ bool Curve<BaseField>::eq(Point &p1, Point &p2) {
 }
 
 
-template <typename BaseField>
-bool Curve<BaseField>::eq(Point &p1, PointAffine &p2) {
+template <typename BaseField, typename Traits>
+bool Curve<BaseField, Traits>::eq(Point &p1, PointAffine &p2) {
 #ifdef COUNT_OPS
     cntEqMixed++;
 #endif // COUNT_OPS
@@ -520,32 +540,32 @@ bool Curve<BaseField>::eq(Point &p1, PointAffine &p2) {
     return (F.isZero(P) && F.isZero(R));
 }
 
-template <typename BaseField>
-bool Curve<BaseField>::eq(PointAffine &p1, PointAffine &p2) {
+template <typename BaseField, typename Traits>
+bool Curve<BaseField, Traits>::eq(PointAffine &p1, PointAffine &p2) {
     return F.eq(p1.x, p2.x) && F.eq(p1.y, p2.y);
 }
 
 
-template <typename BaseField>
-bool Curve<BaseField>::isZero(Point &p1) {
+template <typename BaseField, typename Traits>
+bool Curve<BaseField, Traits>::isZero(Point &p1) {
     return F.isZero(p1.zz);
 }
 
-template <typename BaseField>
-bool Curve<BaseField>::isZero(PointAffine &p1) {
+template <typename BaseField, typename Traits>
+bool Curve<BaseField, Traits>::isZero(PointAffine &p1) {
     return F.isZero(p1.x) && F.isZero(p1.y);
 }
 
-template <typename BaseField>
-void Curve<BaseField>::copy(Point &r, Point &a) {
+template <typename BaseField, typename Traits>
+void Curve<BaseField, Traits>::copy(Point &r, Point &a) {
     F.copy(r.x, a.x);
     F.copy(r.y, a.y);
     F.copy(r.zz, a.zz);
     F.copy(r.zzz, a.zzz);
 }
 
-template <typename BaseField>
-void Curve<BaseField>::copy(Point &r, PointAffine &a) {
+template <typename BaseField, typename Traits>
+void Curve<BaseField, Traits>::copy(Point &r, PointAffine &a) {
     if (isZero(a)) {
         F.copy(r.x, F.one());
         F.copy(r.y, F.one());
@@ -559,8 +579,8 @@ void Curve<BaseField>::copy(Point &r, PointAffine &a) {
     F.copy(r.zzz, F.one());
 }
 
-template <typename BaseField>
-void Curve<BaseField>::copy(PointAffine &r, Point &a) {
+template <typename BaseField, typename Traits>
+void Curve<BaseField, Traits>::copy(PointAffine &r, Point &a) {
 #ifdef COUNT_OPS
     cntToAffine++;
 #endif // COUNT_OPS
@@ -573,30 +593,30 @@ void Curve<BaseField>::copy(PointAffine &r, Point &a) {
     F.div(r.y, a.y, a.zzz);
 }
 
-template <typename BaseField>
-void Curve<BaseField>::copy(PointAffine &r, PointAffine &a) {
+template <typename BaseField, typename Traits>
+void Curve<BaseField, Traits>::copy(PointAffine &r, PointAffine &a) {
     F.copy(r.x, a.x);
     F.copy(r.y, a.y);
 }
 
-template <typename BaseField>
-void Curve<BaseField>::neg(Point &r, Point &a) {
+template <typename BaseField, typename Traits>
+void Curve<BaseField, Traits>::neg(Point &r, Point &a) {
     F.copy(r.x, a.x);
     F.neg(r.y, a.y);
     F.copy(r.zz, a.zz);
     F.copy(r.zzz, a.zzz);
 }
 
-template <typename BaseField>
-void Curve<BaseField>::neg(Point &r, PointAffine &a) {
+template <typename BaseField, typename Traits>
+void Curve<BaseField, Traits>::neg(Point &r, PointAffine &a) {
     F.copy(r.x, a.x);
     F.neg(r.y, a.y);
     F.copy(r.zz, F.one());
     F.copy(r.zzz, F.one());
 }
 
-template <typename BaseField>
-void Curve<BaseField>::neg(PointAffine &r, Point &a) {
+template <typename BaseField, typename Traits>
+void Curve<BaseField, Traits>::neg(PointAffine &r, Point &a) {
 #ifdef COUNT_OPS
     cntToAffine++;
 #endif // COUNT_OPS
@@ -610,15 +630,15 @@ void Curve<BaseField>::neg(PointAffine &r, Point &a) {
     F.neg(r.y, r.y);
 }
 
-template <typename BaseField>
-void Curve<BaseField>::neg(PointAffine &r, PointAffine &a) {
+template <typename BaseField, typename Traits>
+void Curve<BaseField, Traits>::neg(PointAffine &r, PointAffine &a) {
     F.copy(r.x, a.x);
     F.neg(r.y, a.y);
 }
 
 
-template <typename BaseField>
-std::string Curve<BaseField>::toString(Point &p, uint32_t radix) {
+template <typename BaseField, typename Traits>
+std::string Curve<BaseField, Traits>::toString(Point &p, uint32_t radix) {
     PointAffine tmp;
     copy(tmp, p);
     std::ostringstream stringStream;
@@ -627,8 +647,8 @@ std::string Curve<BaseField>::toString(Point &p, uint32_t radix) {
 }
 
 #ifdef COUNT_OPS
-template <typename BaseField>
-void Curve<BaseField>::resetCounters() {
+template <typename BaseField, typename Traits>
+void Curve<BaseField, Traits>::resetCounters() {
     cntAddMixed = 0;
     cntAdd=0;
     cntAddAffine=0;
@@ -639,8 +659,8 @@ void Curve<BaseField>::resetCounters() {
     cntToAffine=0;
 }
 
-template <typename BaseField>
-void Curve<BaseField>::printCounters() {
+template <typename BaseField, typename Traits>
+void Curve<BaseField, Traits>::printCounters() {
     printf("cntAddMixed: %d\n", cntAddMixed);
     printf("cntAdd: %d\n", cntAdd);
     printf("cntAddAffine: %d\n", cntAddAffine);
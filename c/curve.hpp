@@ -2,8 +2,44 @@
 
 #include "exp.hpp"
 #include "multiexp.hpp"
+#include "paramtraits.hpp"
 
+/*
+    Fused point kernels generated for the base field (src/pointbuilder.js).
+    available is false for base fields that do not provide them (e.g. F2Field),
+    and then the generic formulas are used.
+*/
 template <typename BaseField>
+class HasPointKernels {
+    template <typename U> static char test(decltype(&U::pointAddMixed));
+    template <typename U> static long test(...);
+public:
+    static const bool available = sizeof(test<BaseField>(0)) == 1;
+};
+
+template <typename BaseField, bool hasKernels = HasPointKernels<BaseField>::available>
+struct PointKernels {
+    static const bool available = false;
+    template <typename Point, typename PointAffine>
+    static int addMixed(BaseField &, Point &, Point &, PointAffine &) { return -1; }
+    template <typename Point>
+    static int add(BaseField &, Point &, Point &, Point &) { return -1; }
+    template <typename Point>
+    static void dblA0(BaseField &, Point &, Point &) {}
+};
+
+template <typename BaseField>
+struct PointKernels<BaseField, true> {
+    static const bool available = true;
+    template <typename Point, typename PointAffine>
+    static int addMixed(BaseField &F, Point &r, Point &a, PointAffine &b) { return F.pointAddMixed(&r.x, &a.x, &b.x); }
+    template <typename Point>
+    static int add(BaseField &F, Point &r, Point &a, Point &b) { return F.pointAdd(&r.x, &a.x, &b.x); }
+    template <typename Point>
+    static void dblA0(BaseField &F, Point &r, Point &a) { F.pointDblA0(&r.x, &a.x); }
+};
+
+template <typename BaseField, typename Traits = RuntimeCurveTraits>
 class Curve {
 
     void mulByA(typename BaseField::Element &r, typename BaseField::Element &ab);
@@ -24,8 +60,10 @@ private:
 
     void initCurve(typename BaseField::Element &aa, typename BaseField::Element &ab, typename BaseField::Element &agx, typename BaseField::Element &agy);
 
-    enum TypeOfA { a_is_zero, a_is_one, a_is_negone, a_is_long };
-    TypeOfA typeOfA;
+    ParamType typeOfA;
+
+    // Compile time constant unless Traits::A is param_runtime
+    ParamType inline aType() { return Traits::A == param_runtime ? typeOfA : (ParamType)Traits::A; };
 
     // y^2 = x^3 + a*x + b
     typename BaseField::Element fa;
@@ -108,20 +146,20 @@ public:
     void copy(PointAffine &r, PointAffine &a);
 
     void mulByScalar(Point &r, Point &base, uint8_t* scalar, unsigned int scalarSize) {
-        nafMulByScalar<Curve<BaseField>, Point, Point>(*this, r, base, scalar, scalarSize);
+        nafMulByScalar<Curve<BaseField, Traits>, Point, Point>(*this, r, base, scalar, scalarSize);
     }
 
     void mulByScalar(Point &r, PointAffine &base, uint8_t* scalar, unsigned int scalarSize) {
-        nafMulByScalar<Curve<BaseField>, PointAffine, Point>(*this, r, base, scalar, scalarSize);
+        nafMulByScalar<Curve<BaseField, Traits>, PointAffine, Point>(*this, r, base, scalar, scalarSize);
     }
 
     void multiMulByScalar(Point &r, PointAffine *bases, uint8_t* scalars, unsigned int scalarSize, unsigned int n, unsigned int nThreads=0) {
-        ParallelMultiexp<Curve<BaseField>> pm(*this);
+        ParallelMultiexp<Curve<BaseField, Traits>> pm(*this);
         pm.multiexp(r, bases, scalars, scalarSize, n, nThreads);
     }
     void multiMulByScalar(Point &r, PointAffine *bases, uint8_t* scalars, unsigned int scalarSize, unsigned int n,
                           uint32_t nx, uint64_t x[],  unsigned int nThreads=0) {
-        ParallelMultiexp<Curve<BaseField>> pm(*this);
+        ParallelMultiexp<Curve<BaseField, Traits>> pm(*this);
         pm.multiexp(r, bases, scalars, scalarSize, n, nx, x, nThreads);
     }
 #ifdef COUNT_OPS
@@ -0,0 +1,163 @@
+#include "splitparstr.hpp"
+#include "assert.h"
+#include <sstream>
+
+template <typename BaseField>
+F12Field<BaseField>::F12Field(BaseField &aF) : F(aF) {
+    F.copy(fZero.a, F.zero());
+    F.copy(fZero.b, F.zero());
+    F.copy(fOne.a, F.one());
+    F.copy(fOne.b, F.zero());
+    F.copy(fNegOne.a, F.negOne());
+    F.copy(fNegOne.b, F.zero());
+}
+
+
+template <typename BaseField>
+void F12Field<BaseField>::fromString(Element &r, std::string s) {
+
+    auto els = splitParStr(s);
+    assert(els.size() == 2);
+
+    F.fromString(r.a, els[0]);
+    F.fromString(r.b, els[1]);
+}
+
+template <typename BaseField>
+std::string F12Field<BaseField>::toString(Element &e, uint32_t radix) {
+    std::ostringstream stringStream;
+    stringStream << "(" << F.toString(e.a, radix) << "," << F.toString(e.b, radix) << ")";
+    return stringStream.str();
+}
+
+template <typename BaseField>
+void F12Field<BaseField>::add(Element &r, Element &a, Element &b) {
+    F.add(r.a, a.a, b.a);
+    F.add(r.b, a.b, b.b);
+}
+
+template <typename BaseField>
+void F12Field<BaseField>::sub(Element &r, Element &a, Element &b) {
+    F.sub(r.a, a.a, b.a);
+    F.sub(r.b, a.b, b.b);
+}
+
+template <typename BaseField>
+void F12Field<BaseField>::neg(Element &r, Element &a) {
+    F.neg(r.a, a.a);
+    F.neg(r.b, a.b);
+}
+
+// a^(q^6). For elements of the cyclotomic subgroup this is also the inverse.
+template <typename BaseField>
+void F12Field<BaseField>::conjugate(Element &r, Element &a) {
+    F.copy(r.a, a.a);
+    F.neg(r.b, a.b);
+}
+
+template <typename BaseField>
+void F12Field<BaseField>::copy(Element &r, Element &a) {
+    F.copy(r.a, a.a);
+    F.copy(r.b, a.b);
+}
+
+template <typename BaseField>
+void F12Field<BaseField>::mul(Element &r, Element &e1, Element &e2) {
+    typename BaseField::Element aa;
+    F.mul(aa, e1.a, e2.a);
+    typename BaseField::Element bb;
+    F.mul(bb, e1.b, e2.b);
+
+    typename BaseField::Element bbv;
+    F.mulByV(bbv, bb);
+
+    typename BaseField::Element sum1, sum2;
+    F.add(sum1, e1.a, e1.b);
+    F.add(sum2, e2.a, e2.b);
+
+    F.add(r.a, aa, bbv);
+
+    F.mul(r.b, sum1, sum2 );
+    F.sub(r.b, r.b, aa);
+    F.sub(r.b, r.b, bb);
+}
+
+/*
+    Multiplies by a sparse element with only the coefficients of 1, w and w^3 set:
+    ((c0, 0, 0), (c3, c4, 0))
+    This is the shape of the line functions of a D-type twist.
+*/
+template <typename BaseField>
+void F12Field<BaseField>::mulBy034(Element &r, Element &e1, typename BaseField::BaseElement &c0, typename BaseField::BaseElement &c3, typename BaseField::BaseElement &c4) {
+    typename BaseField::Element aa;
+    F.F.mul(aa.a, e1.a.a, c0);
+    F.F.mul(aa.b, e1.a.b, c0);
+    F.F.mul(aa.c, e1.a.c, c0);
+
+    typename BaseField::Element bb;
+    F.mulBy01(bb, e1.b, c3, c4);
+
+    typename BaseField::Element bbv;
+    F.mulByV(bbv, bb);
+
+    typename BaseField::Element sum1;
+    typename BaseField::BaseElement s0;
+    F.add(sum1, e1.a, e1.b);
+    F.F.add(s0, c0, c3);
+
+    F.add(r.a, aa, bbv);
+
+    F.mulBy01(r.b, sum1, s0, c4);
+    F.sub(r.b, r.b, aa);
+    F.sub(r.b, r.b, bb);
+}
+
+template <typename BaseField>
+void F12Field<BaseField>::square(Element &r, Element &e1) {
+    typename BaseField::Element ab;
+    typename BaseField::Element tmp1, tmp2;
+
+    F.mul(ab, e1.a, e1.b);
+
+    F.add(tmp1, e1.a, e1.b);
+    F.mulByV(tmp2, e1.b);
+    F.add(tmp2, e1.a, tmp2);
+
+    F.mul(tmp1, tmp1, tmp2);
+
+    F.mulByV(tmp2, ab);
+    F.add(tmp2, ab, tmp2);
+
+    F.sub(r.a, tmp1, tmp2);
+    F.add(r.b, ab, ab);
+}
+
+template <typename BaseField>
+void F12Field<BaseField>::inv(Element &r, Element &e1) {
+    typename BaseField::Element t0, t1, t2, t3;
+    F.square(t0, e1.a);
+    F.square(t1, e1.b);
+    F.mulByV(t2, t1);
+    F.sub(t2, t0, t2);
+    F.inv(t3, t2);
+    F.mul(r.a, e1.a, t3);
+    F.mul(r.b, e1.b, t3);
+    F.neg(r.b, r.b);
+}
+
+template <typename BaseField>
+void F12Field<BaseField>::div(Element &r, Element &e1, Element &e2) {
+    Element tmp;
+    inv(tmp, e2);
+    mul(r, e1, tmp);
+}
+
+template <typename BaseField>
+bool F12Field<BaseField>::isZero(Element &a) {
+    return F.isZero(a.a) && F.isZero(a.b);
+}
+
+template <typename BaseField>
+bool F12Field<BaseField>::eq(Element &a, Element &b) {
+    return F.eq(a.a, b.a) && F.eq(a.b, b.b);
+}
@@ -0,0 +1,51 @@
+#ifndef F12FIELD_H
+#define F12FIELD_H
+
+#include <string>
+
+// Quadratic extension BaseField[w]/(w^2 - v), where BaseField is an F6Field over v.
+template <typename BaseField>
+class F12Field {
+
+public:
+    struct Element {
+        typename BaseField::Element a;
+        typename BaseField::Element b;
+    };
+
+    BaseField &F;
+private:
+
+    Element fOne;
+    Element fZero;
+    Element fNegOne;
+
+public:
+
+    F12Field(BaseField &aF);
+
+    Element &zero() { return fZero; };
+    Element &one() { return fOne; };
+    Element &negOne() { return fNegOne; };
+
+    void copy(Element &r, Element &a);
+    void add(Element &r, Element &a, Element &b);
+    void sub(Element &r, Element &a, Element &b);
+    void neg(Element &r, Element &a);
+    void conjugate(Element &r, Element &a);
+    void mul(Element &r, Element &a, Element &b);
+    void mulBy034(Element &r, Element &a, typename BaseField::BaseElement &c0, typename BaseField::BaseElement &c3, typename BaseField::BaseElement &c4);
+    void square(Element &r, Element &a);
+    void inv(Element &r, Element &a);
+    void div(Element &r, Element &a, Element &b);
+    bool isZero(Element &a);
+    bool eq(Element &a, Element &b);
+
+    void fromString(Element &r, std::string s);
+    std::string toString(Element &a, uint32_t radix = 10);
+
+};
+
+#include "f12field.cpp"
+
+#endif // F12FIELD_H
@@ -1,14 +1,15 @@
 #include "splitparstr.hpp"
 #include "assert.h"
 #include <sstream>
+#include <stdexcept>
 
-template <typename BaseField>
-F2Field<BaseField>::F2Field(typename BaseField::Element &anr) {
+template <typename BaseField, typename Traits>
+F2Field<BaseField, Traits>::F2Field(typename BaseField::Element &anr) {
     initField(anr);
 }
 
-template <typename BaseField>
-F2Field<BaseField>::F2Field(std::string nrs) {
+template <typename BaseField, typename Traits>
+F2Field<BaseField, Traits>::F2Field(std::string nrs) {
 
     typename BaseField::Element anr;
 
@@ -17,8 +18,8 @@ F2Field<BaseField>::F2Field(std::string nrs) {
     initField(anr);
 }
 
-template <typename BaseField>
-void F2Field<BaseField>::initField(typename BaseField::Element &anr) {
+template <typename BaseField, typename Traits>
+void F2Field<BaseField, Traits>::initField(typename BaseField::Element &anr) {
     F.copy(nr, anr);
     F.copy(fZero.a, F.zero());
     F.copy(fZero.b, F.zero());
@@ -28,19 +29,22 @@ void F2Field<BaseField>::initField(typename BaseField::Element &anr) {
     F.copy(fNegOne.b, F.zero());
 
     if (F.isZero(nr)) {
-        typeOfNr = nr_is_zero;
+        typeOfNr = param_zero;
     } else if (F.eq(nr, F.one())) {
-        typeOfNr = nr_is_one;
+        typeOfNr = param_one;
     } else if (F.eq(nr, F.negOne())) {
-        typeOfNr = nr_is_negone;
+        typeOfNr = param_negone;
     } else {
-        typeOfNr = nr_is_long;
+        typeOfNr = param_long;
+    }
+    if ((Traits::Nr != param_runtime)&&(Traits::Nr != typeOfNr)) {
+        throw std::invalid_argument("F2Field: the non residue does not match the type of the traits");
     }
 }
 
 
-template <typename BaseField>
-void F2Field<BaseField>::fromString(Element &r, std::string s) {
+template <typename BaseField, typename Traits>
+void F2Field<BaseField, Traits>::fromString(Element &r, std::string s) {
 
     auto els = splitParStr(s);
     assert(els.size() == 2);
@@ -49,74 +53,88 @@ void F2Field<BaseField>::fromString(Element &r, std::string s) {
     F.fromString(r.b, els[1]);
 }
 
-template <typename BaseField>
-std::string F2Field<BaseField>::toString(Element &e, uint32_t radix) {
+template <typename BaseField, typename Traits>
+std::string F2Field<BaseField, Traits>::toString(Element &e, uint32_t radix) {
     std::ostringstream stringStream;
     stringStream << "(" << F.toString(e.a, radix) << "," << F.toString(e.b, radix) << ")";
     return stringStream.str();
 }
 
-template <typename BaseField>
-void inline F2Field<BaseField>::mulByNr(typename BaseField::Element &r, typename BaseField::Element &a) {
-    switch (typeOfNr) {
-        case nr_is_zero: F.copy(r, F.zero()); break;
-        case nr_is_one: F.copy(r, a); break;
-        case nr_is_negone: F.neg(r, a); break;
-        case nr_is_long: F.mul(r, nr, a);
+template <typename BaseField, typename Traits>
+void inline F2Field<BaseField, Traits>::mulByNr(typename BaseField::Element &r, typename BaseField::Element &a) {
+    switch (nrType()) {
+        case param_zero: F.copy(r, F.zero()); break;
+        case param_one: F.copy(r, a); break;
+        case param_negone: F.neg(r, a); break;
+        default: F.mul(r, nr, a);
     }
 }
 
-template <typename BaseField>
-void F2Field<BaseField>::add(Element &r, Element &a, Element &b) {
+template <typename BaseField, typename Traits>
+void F2Field<BaseField, Traits>::add(Element &r, Element &a, Element &b) {
     F.add(r.a, a.a, b.a);
     F.add(r.b, a.b, b.b);
 }
 
-template <typename BaseField>
-void F2Field<BaseField>::sub(Element &r, Element &a, Element &b) {
+template <typename BaseField, typename Traits>
+void F2Field<BaseField, Traits>::sub(Element &r, Element &a, Element &b) {
     F.sub(r.a, a.a, b.a);
     F.sub(r.b, a.b, b.b);
 }
 
-template <typename BaseField>
-void F2Field<BaseField>::neg(Element &r, Element &a) {
+template <typename BaseField, typename Traits>
+void F2Field<BaseField, Traits>::neg(Element &r, Element &a) {
     F.neg(r.a, a.a);
     F.neg(r.b, a.b);
 }
 
-template <typename BaseField>
-void F2Field<BaseField>::copy(Element &r, Element &a) {
+template <typename BaseField, typename Traits>
+void F2Field<BaseField, Traits>::copy(Element &r, Element &a) {
     F.copy(r.a, a.a);
     F.copy(r.b, a.b);
 }
 
-template <typename BaseField>
-void F2Field<BaseField>::mul(Element &r, Element &e1, Element &e2) {
-    typename BaseField::Element aa;
-    F.mul(aa, e1.a, e2.a);
-    typename BaseField::Element bb;
-    F.mul(bb, e1.b, e2.b);
-
-    typename BaseField::Element bbr;
-    mulByNr(bbr, bb);
+/*
+    The products are accumulated unreduced and each coefficient is reduced once:
+    r.a = REDC(a0*b0 + nr*a1*b1)
+    r.b = REDC((a0+a1)*(b0+b1) - a0*b0 - a1*b1)
+*/
+template <typename BaseField, typename Traits>
+void F2Field<BaseField, Traits>::mul(Element &r, Element &e1, Element &e2) {
+    typename BaseField::ElementWide aa, bb, ab;
+    F.mulWide(aa, e1.a, e2.a);
+    F.mulWide(bb, e1.b, e2.b);
 
     typename BaseField::Element sum1, sum2;
     F.add(sum1, e1.a, e1.b);
     F.add(sum2, e2.a, e2.b);
 
-    F.add(r.a, aa, bbr);
+    F.mulWide(ab, sum1, sum2);
+    F.subWide(ab, ab, aa);
+    F.subWide(ab, ab, bb);
+
+    switch (nrType()) {
+        case param_zero: F.montReduce(r.a, aa); break;
+        case param_one: F.addWide(aa, aa, bb); F.montReduce(r.a, aa); break;
+        case param_negone: F.subWide(aa, aa, bb); F.montReduce(r.a, aa); break;
+        default: {
+            typename BaseField::Element bbr;
+            F.montReduce(bbr, bb);
+            F.mul(bbr, nr, bbr);
+            F.montReduce(r.a, aa);
+            F.add(r.a, r.a, bbr);
+        }
+    }
 
-    F.mul(r.b, sum1, sum2 );
-    F.sub(r.b, r.b, aa);
-    F.sub(r.b, r.b, bb);
+    F.montReduce(r.b, ab);
 }
 
-template <typename BaseField>
-void F2Field<BaseField>::square(Element &r, Element &e1) {
+template <typename BaseField, typename Traits>
+void F2Field<BaseField, Traits>::square(Element &r, Element &e1) {
     typename BaseField::Element ab;
     typename BaseField::Element tmp1, tmp2;
 
-    if (typeOfNr == nr_is_negone) {
+    if (nrType() == param_negone) {
         F.mul(ab, e1.a, e1.b);
 
         F.add(tmp1, e1.a, e1.b);
@@ -141,8 +159,8 @@ void F2Field<BaseField>::square(Element &r, Element &e1) {
     }
 }
 
-template <typename BaseField>
-void F2Field<BaseField>::inv(Element &r, Element &e1) {
+template <typename BaseField, typename Traits>
+void F2Field<BaseField, Traits>::inv(Element &r, Element &e1) {
     typename BaseField::Element t0, t1, t2, t3;
     F.square(t0, e1.a);
     F.square(t1, e1.b);
@@ -154,19 +172,19 @@ void F2Field<BaseField>::inv(Element &r, Element &e1) {
     F.neg(r.b, r.b);
 }
 
-template <typename BaseField>
-void F2Field<BaseField>::div(Element &r, Element &e1, Element &e2) {
+template <typename BaseField, typename Traits>
+void F2Field<BaseField, Traits>::div(Element &r, Element &e1, Element &e2) {
     Element tmp;
     inv(tmp, e2);
     mul(r, e1, tmp);
 }
 
-template <typename BaseField>
-bool F2Field<BaseField>::isZero(Element &a) {
+template <typename BaseField, typename Traits>
+bool F2Field<BaseField, Traits>::isZero(Element &a) {
     return F.isZero(a.a) && F.isZero(a.b);
 }
 
-template <typename BaseField>
-bool F2Field<BaseField>::eq(Element &a, Element &b) {
+template <typename BaseField, typename Traits>
+bool F2Field<BaseField, Traits>::eq(Element &a, Element &b) {
     return F.eq(a.a, b.a) && F.eq(a.b, b.b);
 }
@@ -1,6 +1,7 @@
 #include <string>
+#include "paramtraits.hpp"
 
-template <typename BaseField>
+template <typename BaseField, typename Traits = RuntimeF2FieldTraits>
 class F2Field {
 
 public:
@@ -11,8 +12,10 @@ public:
 
     BaseField F;
 private:
-    enum TypeOfNr { nr_is_zero, nr_is_one, nr_is_negone, nr_is_long };
-    TypeOfNr typeOfNr;
+    ParamType typeOfNr;
+
+    // Compile time constant unless Traits::Nr is param_runtime
+    ParamType inline nrType() { return Traits::Nr == param_runtime ? typeOfNr : (ParamType)Traits::Nr; };
 
     typename BaseField::Element nr;
 
@@ -0,0 +1,263 @@
+#include "splitparstr.hpp"
+#include "assert.h"
+#include <sstream>
+
+template <typename BaseField>
+F6Field<BaseField>::F6Field(BaseField &aF, typename BaseField::Element &anr) : F(aF) {
+    initField(anr);
+}
+
+template <typename BaseField>
+F6Field<BaseField>::F6Field(BaseField &aF, std::string nrs) : F(aF) {
+
+    typename BaseField::Element anr;
+
+    F.fromString(anr, nrs);
+
+    initField(anr);
+}
+
+template <typename BaseField>
+void F6Field<BaseField>::initField(typename BaseField::Element &anr) {
+    F.copy(nr, anr);
+    F.copy(fZero.a, F.zero());
+    F.copy(fZero.b, F.zero());
+    F.copy(fZero.c, F.zero());
+    F.copy(fOne.a, F.one());
+    F.copy(fOne.b, F.zero());
+    F.copy(fOne.c, F.zero());
+    F.copy(fNegOne.a, F.negOne());
+    F.copy(fNegOne.b, F.zero());
+    F.copy(fNegOne.c, F.zero());
+}
+
+
+template <typename BaseField>
+void F6Field<BaseField>::fromString(Element &r, std::string s) {
+
+    auto els = splitParStr(s);
+    assert(els.size() == 3);
+
+    F.fromString(r.a, els[0]);
+    F.fromString(r.b, els[1]);
+    F.fromString(r.c, els[2]);
+}
+
+template <typename BaseField>
+std::string F6Field<BaseField>::toString(Element &e, uint32_t radix) {
+    std::ostringstream stringStream;
+    stringStream << "(" << F.toString(e.a, radix) << "," << F.toString(e.b, radix) << "," << F.toString(e.c, radix) << ")";
+    return stringStream.str();
+}
+
+template <typename BaseField>
+void inline F6Field<BaseField>::mulByNr(typename BaseField::Element &r, typename BaseField::Element &a) {
+    F.mul(r, nr, a);
+}
+
+template <typename BaseField>
+void F6Field<BaseField>::add(Element &r, Element &a, Element &b) {
+    F.add(r.a, a.a, b.a);
+    F.add(r.b, a.b, b.b);
+    F.add(r.c, a.c, b.c);
+}
+
+template <typename BaseField>
+void F6Field<BaseField>::sub(Element &r, Element &a, Element &b) {
+    F.sub(r.a, a.a, b.a);
+    F.sub(r.b, a.b, b.b);
+    F.sub(r.c, a.c, b.c);
+}
+
+template <typename BaseField>
+void F6Field<BaseField>::neg(Element &r, Element &a) {
+    F.neg(r.a, a.a);
+    F.neg(r.b, a.b);
+    F.neg(r.c, a.c);
+}
+
+template <typename BaseField>
+void F6Field<BaseField>::copy(Element &r, Element &a) {
+    F.copy(r.a, a.a);
+    F.copy(r.b, a.b);
+    F.copy(r.c, a.c);
+}
+
+/*
+    t0 = a0*b0
+    t1 = a1*b1
+    t2 = a2*b2
+    c0 = t0 + nr*((a1+a2)*(b1+b2) - t1 - t2)
+    c1 = (a0+a1)*(b0+b1) - t0 - t1 + nr*t2
+    c2 = (a0+a2)*(b0+b2) - t0 - t2 + t1
+*/
+template <typename BaseField>
+void F6Field<BaseField>::mul(Element &r, Element &e1, Element &e2) {
+    typename BaseField::Element t0, t1, t2;
+    F.mul(t0, e1.a, e2.a);
+    F.mul(t1, e1.b, e2.b);
+    F.mul(t2, e1.c, e2.c);
+
+    typename BaseField::Element s1, s2, c0, c1, c2;
+
+    F.add(s1, e1.b, e1.c);
+    F.add(s2, e2.b, e2.c);
+    F.mul(c0, s1, s2);
+    F.sub(c0, c0, t1);
+    F.sub(c0, c0, t2);
+    mulByNr(c0, c0);
+    F.add(c0, c0, t0);
+
+    F.add(s1, e1.a, e1.b);
+    F.add(s2, e2.a, e2.b);
+    F.mul(c1, s1, s2);
+    F.sub(c1, c1, t0);
+    F.sub(c1, c1, t1);
+    mulByNr(s1, t2);
+    F.add(c1, c1, s1);
+
+    F.add(s1, e1.a, e1.c);
+    F.add(s2, e2.a, e2.c);
+    F.mul(c2, s1, s2);
+    F.sub(c2, c2, t0);
+    F.sub(c2, c2, t2);
+    F.add(c2, c2, t1);
+
+    F.copy(r.a, c0);
+    F.copy(r.b, c1);
+    F.copy(r.c, c2);
+}
+
+/*
+    Same as mul but with b2 = 0. Used by the sparse line multiplications of the pairing.
+    c0 = t0 + nr*(a2*b1)
+    c1 = (a0+a1)*(b0+b1) - t0 - t1
+    c2 = a2*b0 + t1
+*/
+template <typename BaseField>
+void F6Field<BaseField>::mulBy01(Element &r, Element &e1, typename BaseField::Element &b0, typename BaseField::Element &b1) {
+    typename BaseField::Element t0, t1;
+    F.mul(t0, e1.a, b0);
+    F.mul(t1, e1.b, b1);
+
+    typename BaseField::Element s1, s2, c0, c1, c2;
+
+    F.mul(c0, e1.c, b1);
+    mulByNr(c0, c0);
+    F.add(c0, c0, t0);
+
+    F.add(s1, e1.a, e1.b);
+    F.add(s2, b0, b1);
+    F.mul(c1, s1, s2);
+    F.sub(c1, c1, t0);
+    F.sub(c1, c1, t1);
+
+    F.mul(c2, e1.c, b0);
+    F.add(c2, c2, t1);
+
+    F.copy(r.a, c0);
+    F.copy(r.b, c1);
+    F.copy(r.c, c2);
+}
+
+template <typename BaseField>
+void F6Field<BaseField>::mulByV(Element &r, Element &e1) {
+    typename BaseField::Element tmp;
+    mulByNr(tmp, e1.c);
+    F.copy(r.c, e1.b);
+    F.copy(r.b, e1.a);
+    F.copy(r.a, tmp);
+}
+
+/*
+    Chung-Hasan SQR2
+    s0 = a0^2
+    s1 = 2*a0*a1
+    s2 = (a0-a1+a2)^2
+    s3 = 2*a1*a2
+    s4 = a2^2
+    c0 = s0 + nr*s3
+    c1 = s1 + nr*s4
+    c2 = s1 + s2 + s3 - s0 - s4
+*/
+template <typename BaseField>
+void F6Field<BaseField>::square(Element &r, Element &e1) {
+    typename BaseField::Element s0, s1, s2, s3, s4, tmp;
+
+    F.square(s0, e1.a);
+    F.mul(s1, e1.a, e1.b);
+    F.add(s1, s1, s1);
+    F.sub(s2, e1.a, e1.b);
+    F.add(s2, s2, e1.c);
+    F.square(s2, s2);
+    F.mul(s3, e1.b, e1.c);
+    F.add(s3, s3, s3);
+    F.square(s4, e1.c);
+
+    mulByNr(tmp, s3);
+    F.add(r.a, s0, tmp);
+
+    F.add(r.c, s1, s2);
+    F.add(r.c, r.c, s3);
+    F.sub(r.c, r.c, s0);
+    F.sub(r.c, r.c, s4);
+
+    mulByNr(tmp, s4);
+    F.add(r.b, s1, tmp);
+}
+
+/*
+    A = a0^2 - nr*a1*a2
+    B = nr*a2^2 - a0*a1
+    C = a1^2 - a0*a2
+    t = a0*A + nr*(a2*B + a1*C)
+    r = (A, B, C) / t
+*/
+template <typename BaseField>
+void F6Field<BaseField>::inv(Element &r, Element &e1) {
+    typename BaseField::Element A, B, C, t, tmp;
+
+    F.square(A, e1.a);
+    F.mul(tmp, e1.b, e1.c);
+    mulByNr(tmp, tmp);
+    F.sub(A, A, tmp);
+
+    F.square(B, e1.c);
+    mulByNr(B, B);
+    F.mul(tmp, e1.a, e1.b);
+    F.sub(B, B, tmp);
+
+    F.square(C, e1.b);
+    F.mul(tmp, e1.a, e1.c);
+    F.sub(C, C, tmp);
+
+    F.mul(t, e1.c, B);
+    F.mul(tmp, e1.b, C);
+    F.add(t, t, tmp);
+    mulByNr(t, t);
+    F.mul(tmp, e1.a, A);
+    F.add(t, t, tmp);
+
+    F.inv(t, t);
+
+    F.mul(r.a, A, t);
+    F.mul(r.b, B, t);
+    F.mul(r.c, C, t);
+}
+
+template <typename BaseField>
+void F6Field<BaseField>::div(Element &r, Element &e1, Element &e2) {
+    Element tmp;
+    inv(tmp, e2);
+    mul(r, e1, tmp);
+}
+
+template <typename BaseField>
+bool F6Field<BaseField>::isZero(Element &a) {
+    return F.isZero(a.a) && F.isZero(a.b) && F.isZero(a.c);
+}
+
+template <typename BaseField>
+bool F6Field<BaseField>::eq(Element &a, Element &b) {
+    return F.eq(a.a, b.a) && F.eq(a.b, b.b) && F.eq(a.c, b.c);
+}
@@ -0,0 +1,59 @@
+#ifndef F6FIELD_H
+#define F6FIELD_H
+
+#include <string>
+
+// Cubic extension BaseField[v]/(v^3 - nr), where BaseField is usually an F2Field.
+template <typename BaseField>
+class F6Field {
+
+public:
+    struct Element {
+        typename BaseField::Element a;
+        typename BaseField::Element b;
+        typename BaseField::Element c;
+    };
+    typedef typename BaseField::Element BaseElement;
+
+    BaseField &F;
+private:
+    typename BaseField::Element nr;
+
+    Element fOne;
+    Element fZero;
+    Element fNegOne;
+
+    void initField(typename BaseField::Element &anr);
+public:
+
+    F6Field(BaseField &aF, typename BaseField::Element &anr);
+    F6Field(BaseField &aF, std::string nrs);
+
+    Element &zero() { return fZero; };
+    Element &one() { return fOne; };
+    Element &negOne() { return fNegOne; };
+    typename BaseField::Element &nonResidue() { return nr; };
+
+    void mulByNr(typename BaseField::Element &r, typename BaseField::Element &a);
+
+    void copy(Element &r, Element &a);
+    void add(Element &r, Element &a, Element &b);
+    void sub(Element &r, Element &a, Element &b);
+    void neg(Element &r, Element &a);
+    void mul(Element &r, Element &a, Element &b);
+    void mulBy01(Element &r, Element &a, typename BaseField::Element &b0, typename BaseField::Element &b1);
+    void mulByV(Element &r, Element &a);
+    void square(Element &r, Element &a);
+    void inv(Element &r, Element &a);
+    void div(Element &r, Element &a, Element &b);
+    bool isZero(Element &a);
+    bool eq(Element &a, Element &b);
+
+    void fromString(Element &r, std::string s);
+    std::string toString(Element &a, uint32_t radix = 10);
+
+};
+
+#include "f6field.cpp"
+
+#endif // F6FIELD_H
@@ -1,5 +1,15 @@
 #include <thread>
 #include <vector>
+#include <algorithm>
+#include <cstring>
+#include <system_error>
+#include <stdexcept>
+#include <exception>
+#include <utility>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
 #include <omp.h>
 
 using namespace std;
@@ -19,21 +29,90 @@ u_int32_t FFT<Field>::log2(u_int64_t n) {
 
 static inline u_int64_t BR(u_int64_t x, u_int64_t domainPow)
 {
-    x = (x >> 16) | (x << 16);
-    x = ((x & 0xFF00FF00) >> 8) | ((x & 0x00FF00FF) << 8);
-    x = ((x & 0xF0F0F0F0) >> 4) | ((x & 0x0F0F0F0F) << 4);
-    x = ((x & 0xCCCCCCCC) >> 2) | ((x & 0x33333333) << 2);
-    return (((x & 0xAAAAAAAA) >> 1) | ((x & 0x55555555) << 1)) >> (32-domainPow);
+    if (domainPow == 0) return 0;
+    x = (x >> 32) | (x << 32);
+    x = ((x & 0xFFFF0000FFFF0000ULL) >> 16) | ((x & 0x0000FFFF0000FFFFULL) << 16);
+    x = ((x & 0xFF00FF00FF00FF00ULL) >> 8) | ((x & 0x00FF00FF00FF00FFULL) << 8);
+    x = ((x & 0xF0F0F0F0F0F0F0F0ULL) >> 4) | ((x & 0x0F0F0F0F0F0F0F0FULL) << 4);
+    x = ((x & 0xCCCCCCCCCCCCCCCCULL) >> 2) | ((x & 0x3333333333333333ULL) << 2);
+    return (((x & 0xAAAAAAAAAAAAAAAAULL) >> 1) | ((x & 0x5555555555555555ULL) << 1)) >> (64-domainPow);
 }
 
 #define ROOT(s,j) (rootsOfUnit[(1<<(s))+(j)])
 
 template <typename Field>
-FFT<Field>::FFT(u_int64_t maxDomainSize, uint32_t _nThreads) {
-    nThreads = _nThreads==0 ? omp_get_max_threads() : _nThreads;
-    f = Field::field;
+std::mutex &FFTRoots<Field>::registryMutex() {
+    static std::mutex m;
+    return m;
+}
 
-    u_int32_t domainPow = log2(maxDomainSize);
+template <typename Field>
+std::shared_ptr<FFTRoots<Field> > &FFTRoots<Field>::largest() {
+    static std::shared_ptr<FFTRoots<Field> > l;
+    return l;
+}
+
+template <typename Field>
+std::string &FFTRoots<Field>::file() {
+    static std::string fileName;
+    return fileName;
+}
+
+template <typename Field>
+bool &FFTRoots<Field>::compressedTables() {
+    static bool compressed = false;
+    return compressed;
+}
+
+template <typename Field>
+void FFTRoots<Field>::setCompressed(bool compressed) {
+    std::lock_guard<std::mutex> guard(registryMutex());
+    compressedTables() = compressed;
+}
+
+template <typename Field>
+void FFTRoots<Field>::setFile(const std::string &fileName) {
+    std::lock_guard<std::mutex> guard(registryMutex());
+    file() = fileName;
+}
+
+template <typename Field>
+void FFTRoots<Field>::clear() {
+    std::lock_guard<std::mutex> guard(registryMutex());
+    largest().reset();
+}
+
+template <typename Field>
+std::shared_ptr<FFTRoots<Field> > FFTRoots<Field>::get(u_int32_t domainPow) {
+    std::lock_guard<std::mutex> guard(registryMutex());
+    std::shared_ptr<FFTRoots> &l = largest();
+    if ((l)&&(l->s >= domainPow)) return l;
+
+    std::shared_ptr<FFTRoots> t(new FFTRoots());
+    bool compressed = compressedTables();
+    if ((compressed)||(file().empty())||(!t->load(file(), domainPow))) {
+        t->compute(domainPow, compressed);
+        if ((!compressed)&&(!file().empty())) t->save(file());
+    }
+    l = t;
+    return t;
+}
+
+template <typename Field>
+FFTRoots<Field>::~FFTRoots() {
+    if (mapped) {
+        munmap(mapped, mappedSize);
+    } else {
+        delete[] roots;
+    }
+    delete[] hi;
+    delete[] lo;
+    delete[] powTwoInv;
+}
+
+template <typename Field>
+void FFTRoots<Field>::compute(u_int32_t domainPow, bool compressed) {
+    Field &f = Field::field;
 
     mpz_t m_qm1d2;
     mpz_t m_q;
@@ -49,14 +128,9 @@ FFT<Field>::FFT(u_int64_t maxDomainSize, uint32_t _nThreads) {
     mpz_add_ui(m_q, m_aux, 1);
     mpz_fdiv_q_2exp(m_qm1d2, m_aux, 1);
 
-    mpz_set_ui(m_nqr, 2);
-    mpz_powm(m_aux, m_nqr, m_qm1d2, m_q);
-    while (mpz_cmp_ui(m_aux, 1) == 0) {
-        mpz_add_ui(m_nqr, m_nqr, 1);
-        mpz_powm(m_aux, m_nqr, m_qm1d2, m_q);
-    }
-
-    f.fromMpz(nqr, m_nqr);
+    f.fromUI(nqr, 2);
+    while (f.isSquare(nqr)) f.add(nqr, nqr, f.one());
+    f.toMpz(m_nqr, nqr);
 
     // std::cout << "nqr: " << f.toString(nqr) << std::endl;
 
@@ -73,19 +147,42 @@ FFT<Field>::FFT(u_int64_t maxDomainSize, uint32_t _nThreads) {
 
     uint64_t nRoots = 1LL << s;
 
+    if (compressed) {
+        // lo[i] = w^i for i < 2^loPow, hi[i] = w^(i*2^loPow) for i < 2^(s-loPow)
+        Element w;
+        mpz_powm(m_aux, m_nqr, m_aux, m_q);
+        f.fromMpz(w, m_aux);
+        loPow = (s+1)/2;
+        uint64_t nLo = 1LL << loPow;
+        uint64_t nHi = 1LL << (s - loPow);
+        lo = new Element[nLo];
+        hi = new Element[nHi];
+        f.copy(lo[0], f.one());
+        for (uint64_t i=1; i<nLo; i++) f.mul(lo[i], lo[i-1], w);
+        Element wHi;
+        f.mul(wHi, lo[nLo-1], w);
+        f.copy(hi[0], f.one());
+        for (uint64_t i=1; i<nHi; i++) f.mul(hi[i], hi[i-1], wHi);
+        Element aux;
+        f.mul(aux, hi[nHi-1], wHi);
+        assert(f.eq(aux, f.one()));
+
+        computePowTwoInv();
+        mpz_clear(m_qm1d2);
+        mpz_clear(m_q);
+        mpz_clear(m_nqr);
+        mpz_clear(m_aux);
+        return;
+    }
+
     roots = new Element[nRoots];
-    powTwoInv = new Element[s+1];
 
     f.copy(roots[0], f.one());
-    f.copy(powTwoInv[0], f.one());
     if (nRoots>1) {
         mpz_powm(m_aux, m_nqr, m_aux, m_q);
         f.fromMpz(roots[1], m_aux);
-
-        mpz_set_ui(m_aux, 2);
-        mpz_invert(m_aux, m_aux, m_q);
-        f.fromMpz(powTwoInv[1], m_aux);
     }
+    Element *r = roots;
     #pragma omp parallel
     {
         int idThread = omp_get_thread_num();
@@ -94,19 +191,17 @@ FFT<Field>::FFT(u_int64_t maxDomainSize, uint32_t _nThreads) {
         uint64_t start = idThread==0 ? 2 : idThread * increment;
         uint64_t end   = idThread==nThreads-1 ? nRoots : (idThread+1) * increment;
         if (end>start) {
-            f.exp(roots[start], roots[1], (uint8_t *)(&start), sizeof(start));
+            f.exp(r[start], r[1], (uint8_t *)(&start), sizeof(start));
         }
         for (uint64_t i=start+1; i<end; i++) {
-            f.mul(roots[i], roots[i-1], roots[1]);
+            f.mul(r[i], r[i-1], r[1]);
         }
     }
     Element aux;
     f.mul(aux, roots[nRoots-1], roots[1] );
     assert(f.eq(aux, f.one()));
 
-    for (uint64_t i=2; i<=s; i++) {
-        f.mul(powTwoInv[i], powTwoInv[i-1], powTwoInv[1]);
-    }
+    computePowTwoInv();
 
     mpz_clear(m_qm1d2);
     mpz_clear(m_q);
@@ -114,10 +209,247 @@ FFT<Field>::FFT(u_int64_t maxDomainSize, uint32_t _nThreads) {
     mpz_clear(m_aux);
 }
 
+// powTwoInv[i] = 2^-i for i <= s
+template <typename Field>
+void FFTRoots<Field>::computePowTwoInv() {
+    Field &f = Field::field;
+    Element two;
+    powTwoInv = new Element[s+1];
+    f.copy(powTwoInv[0], f.one());
+    f.fromUI(two, 2);
+    f.inv(powTwoInv[1], two);
+    for (uint64_t i=2; i<=s; i++) {
+        f.mul(powTwoInv[i], powTwoInv[i-1], powTwoInv[1]);
+    }
+}
+
+// Roots file: header, negOne (to tell the fields apart), nqr, and the 2^s roots from
+// FFT_ROOTS_FILE_OFFSET, in the in memory format of the elements.
+#define FFT_ROOTS_FILE_MAGIC "FFTROOTS"
+#define FFT_ROOTS_FILE_VERSION 1
+#define FFT_ROOTS_FILE_OFFSET 4096
+
+struct FFTRootsFileHeader {
+    char magic[8];
+    u_int32_t version;
+    u_int32_t elementSize;
+    u_int32_t s;
+    u_int32_t reserved;
+};
+
+// False if the file does not exist, is for another field or has less than 2^domainPow roots
+template <typename Field>
+bool FFTRoots<Field>::load(const std::string &fileName, u_int32_t domainPow) {
+    Field &f = Field::field;
+    static_assert(sizeof(FFTRootsFileHeader) + 2*sizeof(Element) <= FFT_ROOTS_FILE_OFFSET, "Roots file header too big");
+
+    int fd = open(fileName.c_str(), O_RDONLY);
+    if (fd == -1) return false;
+
+    struct stat sb;
+    if (fstat(fd, &sb) == -1) {
+        close(fd);
+        throw std::system_error(errno, std::generic_category(), "fstat");
+    }
+    FFTRootsFileHeader h;
+    Element fileNegOne;
+    if ((read(fd, &h, sizeof(h)) != sizeof(h))
+        ||(memcmp(h.magic, FFT_ROOTS_FILE_MAGIC, 8) != 0)
+        ||(h.version != FFT_ROOTS_FILE_VERSION)
+        ||(h.elementSize != sizeof(Element))
+        ||(h.s < domainPow)
+        ||(h.s > 63)
+        ||((u_int64_t)sb.st_size != FFT_ROOTS_FILE_OFFSET + (sizeof(Element) << h.s))
+        ||(read(fd, &fileNegOne, sizeof(Element)) != sizeof(Element))
+        ||(memcmp(&fileNegOne, &f.negOne(), sizeof(Element)) != 0)
+        ||(read(fd, &nqr, sizeof(Element)) != sizeof(Element))) {
+        close(fd);
+        return false;
+    }
+
+    void *addr = mmap(NULL, sb.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (addr == MAP_FAILED) throw std::system_error(errno, std::generic_category(), "mmap");
+
+    mapped = addr;
+    mappedSize = sb.st_size;
+    s = h.s;
+    roots = (Element *)((char *)addr + FFT_ROOTS_FILE_OFFSET);
+    computePowTwoInv();
+    return true;
+}
+
+// Written to a temporary file and renamed, so other processes never map a partial table
+template <typename Field>
+void FFTRoots<Field>::save(const std::string &fileName) {
+    Field &f = Field::field;
+    std::string tmpName = fileName + "." + std::to_string(getpid()) + ".tmp";
+
+    FFTRootsFileHeader h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, FFT_ROOTS_FILE_MAGIC, 8);
+    h.version = FFT_ROOTS_FILE_VERSION;
+    h.elementSize = sizeof(Element);
+    h.s = s;
+
+    char *head = new char[FFT_ROOTS_FILE_OFFSET];
+    memset(head, 0, FFT_ROOTS_FILE_OFFSET);
+    memcpy(head, &h, sizeof(h));
+    memcpy(head + sizeof(h), &f.negOne(), sizeof(Element));
+    memcpy(head + sizeof(h) + sizeof(Element), &nqr, sizeof(Element));
+
+    FILE *fp = fopen(tmpName.c_str(), "wb");
+    if (!fp) {
+        delete[] head;
+        throw std::system_error(errno, std::generic_category(), "fopen");
+    }
+    bool ok = (fwrite(head, 1, FFT_ROOTS_FILE_OFFSET, fp) == FFT_ROOTS_FILE_OFFSET)
+           && (fwrite(roots, sizeof(Element), (u_int64_t)1 << s, fp) == ((u_int64_t)1 << s));
+    delete[] head;
+    if ((fclose(fp) != 0)||(!ok)) {
+        int err = errno;
+        unlink(tmpName.c_str());
+        throw std::system_error(err, std::generic_category(), "fwrite");
+    }
+    if (rename(tmpName.c_str(), fileName.c_str()) != 0) {
+        int err = errno;
+        unlink(tmpName.c_str());
+        throw std::system_error(err, std::generic_category(), "rename");
+    }
+}
+
+template <typename Field>
+FFT<Field>::FFT(u_int64_t maxDomainSize, uint32_t _nThreads) {
+    nThreads = _nThreads==0 ? omp_get_max_threads() : _nThreads;
+    f = Field::field;
+
+    // For 2^k*m the power of two domains go up to maxDomainSize or the two-adicity of the field,
+    // whichever is smaller, and the roots of 2^k are needed in any case
+    u_int32_t domainPow = log2(maxDomainSize);
+    if (maxDomainSize & (maxDomainSize - 1)) {
+        mpz_t m_qm1;
+        mpz_init(m_qm1);
+        f.toMpz(m_qm1, f.negOne());
+        u_int32_t twoAdicity = mpz_scan1(m_qm1, 0);
+        mpz_clear(m_qm1);
+        domainPow = std::max(log2(maxDomainSize & (~maxDomainSize + 1)), std::min(domainPow, twoAdicity));
+    }
+    rootsTable = FFTRoots<Field>::get(domainPow);
+    s = rootsTable->s;
+    f.copy(nqr, rootsTable->nqr);
+    roots = rootsTable->roots;
+    rootsHi = rootsTable->hi;
+    rootsLo = rootsTable->lo;
+    rootsLoPow = rootsTable->loPow;
+    powTwoInv = rootsTable->powTwoInv;
+
+    u_int64_t maxOdd = maxDomainSize;
+    while (maxOdd && !(maxOdd & 1)) maxOdd >>= 1;
+    computeOddRoots(maxOdd);
+}
+
+// oddOrder = gcd(maxOdd, q-1) and v = x^((q-1)/oddOrder) for the first x >= 2 with
+// x^((q-1)/p) != 1 for every prime p of oddOrder, so v has order oddOrder.
+template <typename Field>
+void FFT<Field>::computeOddRoots(u_int64_t maxOdd) {
+    mpz_t m_qm1;
+    mpz_t m_aux;
+    mpz_t m_x;
+    mpz_init(m_qm1);
+    mpz_init(m_aux);
+    mpz_init(m_x);
+    f.toMpz(m_qm1, f.negOne());
+    mpz_add_ui(m_aux, m_qm1, 1);
+
+    oddOrder = maxOdd ? mpz_gcd_ui(NULL, m_qm1, maxOdd) : 1;
+    std::vector<u_int64_t> primes;
+    u_int64_t rest = oddOrder;
+    for (u_int64_t p=3; p*p<=rest; p+=2) {
+        if (rest % p) continue;
+        primes.push_back(p);
+        while (!(rest % p)) rest /= p;
+    }
+    if (rest > 1) primes.push_back(rest);
+
+    mpz_t m_q;
+    mpz_init_set(m_q, m_aux);
+    mpz_set_ui(m_x, 2);
+    while (true) {
+        bool full = true;
+        for (u_int64_t i=0; i<primes.size() && full; i++) {
+            mpz_divexact_ui(m_aux, m_qm1, primes[i]);
+            mpz_powm(m_aux, m_x, m_aux, m_q);
+            full = mpz_cmp_ui(m_aux, 1) != 0;
+        }
+        if (full) break;
+        mpz_add_ui(m_x, m_x, 1);
+    }
+    mpz_divexact_ui(m_aux, m_qm1, oddOrder);
+    mpz_powm(m_aux, m_x, m_aux, m_q);
+
+    Element v;
+    f.fromMpz(v, m_aux);
+    oddRoots = new Element[oddOrder];
+    f.copy(oddRoots[0], f.one());
+    for (u_int64_t i=1; i<oddOrder; i++) f.mul(oddRoots[i], oddRoots[i-1], v);
+
+    mpz_clear(m_qm1);
+    mpz_clear(m_aux);
+    mpz_clear(m_x);
+    mpz_clear(m_q);
+}
+
 template <typename Field>
 FFT<Field>::~FFT() {
-    delete[] roots;
-    delete[] powTwoInv;
+    delete[] oddRoots;
+}
+
+#ifndef FFT_POWERS_TABLES
+#define FFT_POWERS_TABLES 4
+#endif
+
+// Tables of powers for the coset transforms, cached for the last FFT_POWERS_TABLES (n, start,
+// ratio) used. The caller shares the ownership, so a table evicted by another thread stays
+// valid until its transform ends.
+template <typename Field>
+std::shared_ptr<typename Field::Element> FFT<Field>::powersTable(u_int64_t n, const Element &start, const Element &ratio) {
+    std::lock_guard<std::mutex> guard(powersMutex);
+    for (u_int64_t i=0; i<powersTables.size(); i++) {
+        PowersTable &t = powersTables[i];
+        if ((t.n == n)&&(f.eq(t.start, start))&&(f.eq(t.ratio, ratio))) {
+            std::rotate(powersTables.begin() + i, powersTables.begin() + i + 1, powersTables.end());
+            return powersTables.back().powers;
+        }
+    }
+
+    PowersTable t;
+    t.n = n;
+    f.copy(t.start, start);
+    f.copy(t.ratio, ratio);
+    t.powers = std::shared_ptr<Element>(new Element[n], std::default_delete<Element[]>());
+    Element *p = t.powers.get();
+    #pragma omp parallel
+    {
+        int idThread = omp_get_thread_num();
+        int nThreads = omp_get_num_threads();
+        uint64_t increment = n / nThreads;
+        uint64_t from = idThread * increment;
+        uint64_t to   = idThread==nThreads-1 ? n : (idThread+1) * increment;
+        if (to>from) {
+            if (from == 0) {
+                f.copy(p[0], start);
+            } else {
+                f.exp(p[from], ratio, (uint8_t *)(&from), sizeof(from));
+                f.mul(p[from], p[from], start);
+            }
+        }
+        for (uint64_t i=from+1; i<to; i++) {
+            f.mul(p[i], p[i-1], ratio);
+        }
+    }
+    if (powersTables.size() == FFT_POWERS_TABLES) powersTables.erase(powersTables.begin());
+    powersTables.push_back(t);
+    return t.powers;
 }
 
 /*
@@ -155,60 +487,1147 @@ void FFT<Field>::reversePermutation(Element *a, u_int64_t n) {
 */
 
 
+// Maximum size in bytes of each of the two reversePermutation tiles (per thread)
+#ifndef FFT_COBRA_TILE_BYTES
+#define FFT_COBRA_TILE_BYTES (1 << 17)
+#endif
+
+// COBRA: the index is split as hi|mid|lo with q bit hi and lo, and BR(hi|mid|lo) = BR(lo)|BR(mid)|BR(hi).
+// The 2^q x 2^q tile of a mid (rows of 2^q consecutive elements) goes to the tile of BR(mid)
+// transposed and with the rows and columns bit reversed, so each pair of tiles is read into two
+// buffers and written back row by row, instead of swapping single elements across the array.
+template <typename Field>
+u_int32_t FFT<Field>::cobraBits() {
+    u_int32_t q = 1;
+    while ((sizeof(Element) << (2*q + 2)) <= FFT_COBRA_TILE_BYTES) q++;
+    return q;
+}
+
+// The pairs of tiles mid, BR(mid) of reversePermutation with mid in [from, to), t1 and t2 of
+// 2^(2q) elements and brq[i] = BR(i, q)
+template <typename Field>
+void FFT<Field>::reverseTiles(Element *a, u_int32_t domainPow, u_int32_t q, u_int64_t from, u_int64_t to, Element *t1, Element *t2, const u_int64_t *brq) {
+    u_int32_t midPow = domainPow - 2*q;
+    u_int64_t rowSize = (u_int64_t)1 << q;
+    u_int32_t hiShift = midPow + q;
+    for (u_int64_t mid=from; mid<to; mid++) {
+        u_int64_t rmid = BR(mid, midPow);
+        if (rmid < mid) continue;
+        for (u_int64_t hi=0; hi<rowSize; hi++) {
+            const Element *src1 = a + ((hi << hiShift) | (mid << q));
+            const Element *src2 = a + ((hi << hiShift) | (rmid << q));
+            for (u_int64_t lo=0; lo<rowSize; lo++) f.copy(t1[hi*rowSize + lo], src1[lo]);
+            if (rmid != mid) {
+                for (u_int64_t lo=0; lo<rowSize; lo++) f.copy(t2[hi*rowSize + lo], src2[lo]);
+            }
+        }
+        // a[BR(lo)|BR(mid)|BR(hi)] = t[hi][lo]
+        for (u_int64_t r=0; r<rowSize; r++) {
+            Element *dst1 = a + ((r << hiShift) | (rmid << q));
+            Element *dst2 = a + ((r << hiShift) | (mid << q));
+            for (u_int64_t d=0; d<rowSize; d++) f.copy(dst1[d], t1[brq[d]*rowSize + brq[r]]);
+            if (rmid != mid) {
+                for (u_int64_t d=0; d<rowSize; d++) f.copy(dst2[d], t2[brq[d]*rowSize + brq[r]]);
+            }
+        }
+    }
+}
+
 template <typename Field>
 void FFT<Field>::reversePermutation(Element *a, u_int64_t n) {
-    int domainPow = log2(n);
-    #pragma omp parallel for
-    for (u_int64_t i=0; i<n; i++) {
-        Element tmp;
-        u_int64_t r = BR(i, domainPow);
-        if (i>r) {
-            f.copy(tmp, a[i]);
-            f.copy(a[i], a[r]);
-            f.copy(a[r], tmp);
+    u_int32_t domainPow = log2(n);
+    u_int32_t q = cobraBits();
+
+    if (domainPow < 2*q) {
+        for (u_int64_t i=0; i<n; i++) {
+            u_int64_t r = BR(i, domainPow);
+            if (i>r) f.swap(a[i], a[r]);
+        }
+        return;
+    }
+
+    u_int64_t nMid = (u_int64_t)1 << (domainPow - 2*q);
+    u_int64_t rowSize = (u_int64_t)1 << q;
+    std::vector<u_int64_t> brq(rowSize);
+    for (u_int64_t i=0; i<rowSize; i++) brq[i] = BR(i, q);
+
+    #pragma omp parallel
+    {
+        Element *t1 = new Element[rowSize*rowSize];
+        Element *t2 = new Element[rowSize*rowSize];
+        #pragma omp for schedule(dynamic, 16)
+        for (u_int64_t mid=0; mid<nMid; mid++) {
+            reverseTiles(a, domainPow, q, mid, mid + 1, t1, t2, brq.data());
         }
+        delete[] t1;
+        delete[] t2;
     }
 }
 
 
+// Butterflies are processed in chunks so the twiddle multiplications go through mulBatch
+#define FFT_BATCH 64
+
+// Domains of at least this size (in bytes) do not fit in the cache and go through fftSixStep
+#ifndef FFT_SIXSTEP_MIN_BYTES
+#define FFT_SIXSTEP_MIN_BYTES (1 << 18)
+#endif
+// Columns gathered at once by fftSixStep and tile size of the transpositions
+#define FFT_SIXSTEP_COLS 8
+#define FFT_TRANSPOSE_TILE 32
+
 template <typename Field>
 void FFT<Field>::fft(Element *a, u_int64_t n) {
-    reversePermutation(a, n);
+    fftScaled(&a, 1, n, NULL);
+}
+
+template <typename Field>
+void FFT<Field>::fft(Element **polys, u_int32_t nPolys, u_int64_t n) {
+    if (nPolys == 1) {
+        fft(polys[0], n);
+        return;
+    }
+    fftScaled(polys, nPolys, n, NULL);
+}
+
+// fft of polys[p][i]*scale[i] if scale is not NULL. The twiddles of each batch of butterflies
+// are loaded once for all the polynomials.
+template <typename Field>
+void FFT<Field>::fftScaled(Element **polys, u_int32_t nPolys, u_int64_t n, const Element *scale) {
+    if (n & (n-1)) {
+        fftMixed(polys, nPolys, n, scale);
+        return;
+    }
+    if (n*sizeof(Element) >= FFT_SIXSTEP_MIN_BYTES) {
+        fftSixStep(polys, nPolys, n, scale);
+        return;
+    }
+    for (u_int32_t p=0; p<nPolys; p++) reversePermutation(polys[p], n);
     u_int64_t domainPow =log2(n);
     assert(((u_int64_t)1 << domainPow) == n);
+    Element *wr = new Element[n >> 1];
+    blockRoots(wr, domainPow);
+    #pragma omp parallel
     for (u_int32_t s=1; s<=domainPow; s++) {
         u_int64_t m = 1 << s;
         u_int64_t mdiv2 = m >> 1;
-        #pragma omp parallel for
-        for (u_int64_t i=0; i< (n>>1); i++) {
-            Element t;
+        #pragma omp for
+        for (u_int64_t i0=0; i0< (n>>1); i0 += FFT_BATCH) {
+            Element w[FFT_BATCH];
+            Element se[FFT_BATCH];
+            Element x[FFT_BATCH];
+            Element t[FFT_BATCH];
             Element u;
-            u_int64_t k=(i/mdiv2)*m;
-            u_int64_t j=i%mdiv2;
+            u_int64_t nb = std::min((u_int64_t)FFT_BATCH, (n>>1) - i0);
+            bool scaled = (scale)&&(s == 1);
+            for (u_int64_t c=0; c<nb; c++) {
+                u_int64_t j=(i0+c)%mdiv2;
+                f.copy(w[c], wr[j << (domainPow - s)]);
+            }
+            if (scaled) {
+                // a[i] is the element BR(i), the roots of this stage are all 1 so its
+                // twiddles are the scale of the odd elements. The even ones are scaled apart.
+                for (u_int64_t c=0; c<nb; c++) {
+                    u_int64_t k=(i0+c)*2;
+                    f.copy(w[c], scale[BR(k+1, domainPow)]);
+                    f.copy(se[c], scale[BR(k, domainPow)]);
+                }
+            }
+            for (u_int32_t p=0; p<nPolys; p++) {
+                Element *a = polys[p];
+                if (scaled) {
+                    for (u_int64_t c=0; c<nb; c++) f.copy(x[c], a[(i0+c)*2]);
+                    f.mulBatch(x, x, se, nb);
+                    for (u_int64_t c=0; c<nb; c++) f.copy(a[(i0+c)*2], x[c]);
+                }
+                for (u_int64_t c=0; c<nb; c++) {
+                    u_int64_t k=((i0+c)/mdiv2)*m;
+                    u_int64_t j=(i0+c)%mdiv2;
+                    f.copy(x[c], a[k+j+mdiv2]);
+                }
+                f.mulBatch(t, w, x, nb);
+                for (u_int64_t c=0; c<nb; c++) {
+                    u_int64_t k=((i0+c)/mdiv2)*m;
+                    u_int64_t j=(i0+c)%mdiv2;
+                    f.copy(u,a[k+j]);
+                    f.add(a[k+j], t[c], u);
+                    f.sub(a[k+j+mdiv2], u, t[c]);
+                }
+            }
+        }
+    }
+    delete[] wr;
+}
 
-            f.mul(t, root(s, j), a[k+j+mdiv2]);
-            f.copy(u,a[k+j]);
-            f.add(a[k+j], t, u);
-            f.sub(a[k+j+mdiv2], u, t);
+// w[j] = root(domainPow, j) for j < n/2, so the stages of a small FFT do not stride over roots
+template <typename Field>
+void FFT<Field>::blockRoots(Element *w, u_int32_t domainPow) {
+    u_int64_t nw = ((u_int64_t)1 << domainPow) >> 1;
+    for (u_int64_t j=0; j<nw; j++) f.copy(w[j], root(domainPow, j));
+}
+
+// Radix-2 FFT of a block that fits in the cache, with the roots of blockRoots. It runs in the
+// calling thread so it can be used inside the parallel loops of fftSixStep.
+template <typename Field>
+void FFT<Field>::fftBlock(Element *a, u_int32_t domainPow, const Element *w) {
+    u_int64_t n = (u_int64_t)1 << domainPow;
+    for (u_int64_t i=0; i<n; i++) {
+        u_int64_t r = BR(i, domainPow);
+        if (i>r) f.swap(a[i], a[r]);
+    }
+    Element wb[FFT_BATCH];
+    Element x[FFT_BATCH];
+    Element t[FFT_BATCH];
+    Element u;
+    for (u_int32_t s=1; s<=domainPow; s++) {
+        u_int64_t mdiv2 = (u_int64_t)1 << (s-1);
+        for (u_int64_t i0=0; i0< (n>>1); i0 += FFT_BATCH) {
+            u_int64_t nb = std::min((u_int64_t)FFT_BATCH, (n>>1) - i0);
+            for (u_int64_t c=0; c<nb; c++) {
+                u_int64_t k=((i0+c) >> (s-1)) << s;
+                u_int64_t j=(i0+c) & (mdiv2-1);
+                f.copy(wb[c], w[j << (domainPow-s)]);
+                f.copy(x[c], a[k+j+mdiv2]);
+            }
+            f.mulBatch(t, wb, x, nb);
+            for (u_int64_t c=0; c<nb; c++) {
+                u_int64_t k=((i0+c) >> (s-1)) << s;
+                u_int64_t j=(i0+c) & (mdiv2-1);
+                f.copy(u,a[k+j]);
+                f.add(a[k+j], t[c], u);
+                f.sub(a[k+j+mdiv2], u, t[c]);
+            }
         }
     }
 }
 
+// In place transposition of the n x n matrix a, by tiles
+template <typename Field>
+void FFT<Field>::transposeSquare(Element *a, u_int64_t n) {
+    #pragma omp parallel for schedule(dynamic)
+    for (u_int64_t i0=0; i0<n; i0 += FFT_TRANSPOSE_TILE) {
+        u_int64_t i1 = std::min(i0 + FFT_TRANSPOSE_TILE, n);
+        for (u_int64_t j0=i0; j0<n; j0 += FFT_TRANSPOSE_TILE) {
+            u_int64_t j1 = std::min(j0 + FFT_TRANSPOSE_TILE, n);
+            for (u_int64_t i=i0; i<i1; i++) {
+                for (u_int64_t j=(j0 == i0 ? i+1 : j0); j<j1; j++) {
+                    std::swap(a[i*n + j], a[j*n + i]);
+                }
+            }
+        }
+    }
+}
+
+// Moves row p of a to 2*p if it is in the first half and to 2*(p - nRows/2) + 1 otherwise,
+// following the cycles of the permutation with one row of extra memory per thread.
+template <typename Field>
+void FFT<Field>::shuffleRows(Element *a, u_int64_t nRows, u_int64_t rowSize) {
+    u_int64_t half = nRows >> 1;
+    std::vector<bool> visited(nRows, false);
+    std::vector<u_int64_t> leaders;
+    for (u_int64_t p=0; p<nRows; p++) {
+        if (visited[p]) continue;
+        u_int64_t len = 0;
+        u_int64_t cur = p;
+        do {
+            visited[cur] = true;
+            cur = cur < half ? 2*cur : 2*(cur - half) + 1;
+            len++;
+        } while (cur != p);
+        if (len > 1) leaders.push_back(p);
+    }
+
+    #pragma omp parallel
+    {
+        Element *tmp = new Element[rowSize];
+        #pragma omp for schedule(dynamic)
+        for (u_int64_t l=0; l<leaders.size(); l++) {
+            u_int64_t p = leaders[l];
+            std::copy(a + p*rowSize, a + (p+1)*rowSize, tmp);
+            u_int64_t cur = p;
+            while (true) {
+                // The row that goes to cur
+                u_int64_t src = (cur & 1) ? half + (cur >> 1) : cur >> 1;
+                if (src == p) break;
+                std::copy(a + src*rowSize, a + (src+1)*rowSize, a + cur*rowSize);
+                cur = src;
+            }
+            std::copy(tmp, tmp + rowSize, a + cur*rowSize);
+        }
+        delete[] tmp;
+    }
+}
+
+// Bailey's FFT for the domains that do not fit in the cache. With n = n1*n2, a is seen as n2
+// rows of n1 elements and the transform is
+//   1. FFT of size n2 of each column, multiplied by root(log2(n), j1*k2). The columns are
+//      gathered in groups of FFT_SIXSTEP_COLS into a buffer and written back in place, which
+//      takes the place of the first two transpositions.
+//   2. FFT of size n1 of each row.
+//   3. Transposition, so a[k1*n2 + k2] = X[k2 + n2*k1].
+// The sub FFTs fit in the cache and use their own copy of the roots, so a is read three times
+// instead of once per stage.
+template <typename Field>
+void FFT<Field>::fftSixStep(Element **polys, u_int32_t nPolys, u_int64_t n, const Element *scale) {
+    u_int32_t domainPow = log2(n);
+    assert(((u_int64_t)1 << domainPow) == n);
+    u_int32_t pow1 = domainPow/2;
+    u_int32_t pow2 = domainPow - pow1;
+    u_int64_t n1 = (u_int64_t)1 << pow1;
+    u_int64_t n2 = (u_int64_t)1 << pow2;
+    u_int64_t nCols = std::min((u_int64_t)FFT_SIXSTEP_COLS, n1);
+
+    Element *w1 = new Element[n1 >> 1];
+    Element *w2 = new Element[n2 >> 1];
+    blockRoots(w1, pow1);
+    blockRoots(w2, pow2);
+
+    #pragma omp parallel
+    {
+        Element *buff = new Element[nCols*n2];
+        Element *sbuff = scale ? new Element[nCols*n2] : NULL;
+        Element *tw = new Element[nCols*n2];
+        Element *bc = new Element[n2 >> 1];
+        #pragma omp for
+        for (u_int64_t j0=0; j0<n1; j0 += nCols) {
+            // tw[c*n2 + k] = root(domainPow, (j0+c)*k), each half is the previous one times a
+            // root. They are the same for all the polynomials.
+            for (u_int64_t c=0; c<nCols; c++) {
+                Element *twc = tw + c*n2;
+                f.copy(twc[0], f.one());
+                for (u_int32_t i=0; i<pow2; i++) {
+                    u_int64_t h = (u_int64_t)1 << i;
+                    const Element &r = root(domainPow, ((j0+c) << i) & (n-1));
+                    for (u_int64_t l=0; l<h; l++) bc[l] = r;
+                    f.mulBatch(twc + h, twc, bc, h);
+                }
+            }
+            if (scale) {
+                for (u_int64_t k=0; k<n2; k++) {
+                    for (u_int64_t c=0; c<nCols; c++) sbuff[c*n2 + k] = scale[k*n1 + j0 + c];
+                }
+            }
+            for (u_int32_t p=0; p<nPolys; p++) {
+                Element *a = polys[p];
+                for (u_int64_t k=0; k<n2; k++) {
+                    for (u_int64_t c=0; c<nCols; c++) buff[c*n2 + k] = a[k*n1 + j0 + c];
+                }
+                if (scale) f.mulBatch(buff, buff, sbuff, nCols*n2);
+                for (u_int64_t c=0; c<nCols; c++) {
+                    Element *col = buff + c*n2;
+                    fftBlock(col, pow2, w2);
+                    f.mulBatch(col, col, tw + c*n2, n2);
+                }
+                for (u_int64_t k=0; k<n2; k++) {
+                    for (u_int64_t c=0; c<nCols; c++) a[k*n1 + j0 + c] = buff[c*n2 + k];
+                }
+            }
+        }
+        delete[] buff;
+        delete[] sbuff;
+        delete[] tw;
+        delete[] bc;
+    }
+
+    #pragma omp parallel for
+    for (u_int64_t r=0; r<nPolys*n2; r++) {
+        fftBlock(polys[r / n2] + (r % n2)*n1, pow1, w1);
+    }
+
+    // n2 is n1 or 2*n1. In the second case both halves are transposed and their rows interleaved.
+    for (u_int32_t p=0; p<nPolys; p++) {
+        Element *a = polys[p];
+        transposeSquare(a, n1);
+        if (n2 != n1) {
+            transposeSquare(a + n1*n1, n1);
+            shuffleRows(a, n2, n1);
+        }
+    }
+
+    delete[] w1;
+    delete[] w2;
+}
+
+// Mixed radix FFT for n = n1*m, n1 = 2^k and m > 1 odd. With j = m*j1 + j2 and k = k1 + n1*k2
+// the transform is
+//   1. FFT of size n1 of each of the m subsequences a[m*j1 + j2], gathered in tmp.
+//   2. Multiplication by w^(j2*k1).
+//   3. DFT of size m over j2 for each k1, with smallDft, into a[k1 + n1*k2].
+// w, the root of order n, is the one with w^m = root(k, 1) and w^n1 = v, the root of order m of
+// oddRoots: w = root(k, 1)^(m^-1 mod n1) * v^(n1^-1 mod m). So the sub FFTs are the usual ones
+// and fft of a power of two domain does not change.
+template <typename Field>
+void FFT<Field>::fftMixed(Element **polys, u_int32_t nPolys, u_int64_t n, const Element *scale) {
+    u_int64_t n1 = n & (~n + 1);
+    u_int64_t m = n / n1;
+    if (oddOrder % m) throw std::range_error("Domain size not supported by the roots of the FFT");
+    u_int32_t k = log2(n1);
+
+    // vp[i] = v^i
+    std::vector<Element> vp(m);
+    for (u_int64_t i=0; i<m; i++) f.copy(vp[i], oddRoots[i*(oddOrder/m)]);
+    // a1 = m^-1 mod n1 (Newton, each step doubles the correct bits), b1 = n1^-1 mod m
+    u_int64_t a1 = m;
+    for (int i=0; i<6; i++) a1 *= 2 - m*a1;
+    u_int64_t b1 = 1;
+    while (((n1 % m)*b1) % m != 1) b1++;
+    auto mixedRoot = [&](Element &r, u_int64_t e) {
+        f.mul(r, root(k, (a1*e) & (n1-1)), vp[(b1*(e % m)) % m]);
+    };
+
+    // stepPow[j2*FFT_BATCH + c] = w^(j2*c)
+    Element *stepPow = new Element[m*FFT_BATCH];
+    for (u_int64_t j2=0; j2<m; j2++) {
+        for (u_int64_t c=0; c<FFT_BATCH; c++) mixedRoot(stepPow[j2*FFT_BATCH + c], j2*c);
+    }
+
+    Element *tmp = new Element[n];
+    for (u_int32_t p=0; p<nPolys; p++) {
+        Element *a = polys[p];
+        #pragma omp parallel for
+        for (u_int64_t j1=0; j1<n1; j1++) {
+            for (u_int64_t j2=0; j2<m; j2++) {
+                if (scale) {
+                    f.mul(tmp[j2*n1 + j1], a[m*j1 + j2], scale[m*j1 + j2]);
+                } else {
+                    f.copy(tmp[j2*n1 + j1], a[m*j1 + j2]);
+                }
+            }
+        }
+        if (n1 > 1) {
+            for (u_int64_t j2=0; j2<m; j2++) fft(tmp + j2*n1, n1);
+        }
+
+        #pragma omp parallel
+        {
+            Element *x = new Element[m*FFT_BATCH];
+            Element *y = new Element[m*FFT_BATCH];
+            Element tw[FFT_BATCH];
+            Element bc[FFT_BATCH];
+            #pragma omp for
+            for (u_int64_t k10=0; k10<n1; k10 += FFT_BATCH) {
+                u_int64_t nb = std::min((u_int64_t)FFT_BATCH, n1 - k10);
+                for (u_int64_t j2=0; j2<m; j2++) {
+                    Element *xr = x + j2*FFT_BATCH;
+                    for (u_int64_t c=0; c<nb; c++) f.copy(xr[c], tmp[j2*n1 + k10 + c]);
+                    if (j2 == 0) continue;
+                    mixedRoot(bc[0], j2*k10);
+                    for (u_int64_t c=1; c<nb; c++) f.copy(bc[c], bc[0]);
+                    f.mulBatch(tw, stepPow + j2*FFT_BATCH, bc, nb);
+                    f.mulBatch(xr, xr, tw, nb);
+                }
+                smallDft(y, x, 1, m, vp.data(), m, nb);
+                for (u_int64_t k2=0; k2<m; k2++) {
+                    for (u_int64_t c=0; c<nb; c++) f.copy(a[k10 + c + n1*k2], y[k2*FFT_BATCH + c]);
+                }
+            }
+            delete[] x;
+            delete[] y;
+        }
+    }
+    delete[] tmp;
+    delete[] stepPow;
+}
+
+// DFT of size m (odd) of the rows in[0], in[stride], ..., in[(m-1)*stride] into the m rows of
+// out. Rows have nb elements and are FFT_BATCH apart, vp[i] = v^i for a root v of order mv and
+// m divides mv. Cooley-Tukey on the smallest prime p of m: the DFTs of size r = m/p of the p
+// interleaved subsequences go to the rows t*r + k of out, and then each group of rows
+// k, k + r, ..., k + (p-1)*r gets its twiddles and a radix-p butterfly in place. For p = 3 the
+// butterfly takes two products, with v3 + v3^2 = -1; other primes use the plain DFT.
+template <typename Field>
+void FFT<Field>::smallDft(Element *out, const Element *in, u_int64_t stride, u_int64_t m, const Element *vp, u_int64_t mv, u_int64_t nb) {
+    if (m == 1) {
+        for (u_int64_t c=0; c<nb; c++) f.copy(out[c], in[c]);
+        return;
+    }
+    u_int64_t p = 3;
+    while (m % p) p += 2;
+    u_int64_t r = m / p;
+    for (u_int64_t t=0; t<p; t++) {
+        smallDft(out + t*r*FFT_BATCH, in + t*stride*FFT_BATCH, stride*p, r, vp, mv, nb);
+    }
+
+    // x_t = v_m^(t*k) Y_t[k], y[k + r*q] = sum_t x_t v_p^(t*q)
+    u_int64_t step = mv / m;
+    u_int64_t stepP = mv / p;
+    if (p == 3) {
+        // y1, y2 = x0 - (x1 + x2)/2 +- (v3 - v3^2)/2 (x1 - x2)
+        Element h, c3;
+        f.sub(h, f.zero(), powTwoInv[1]);
+        f.sub(c3, vp[stepP], vp[2*stepP]);
+        f.mul(c3, c3, powTwoInv[1]);
+        for (u_int64_t k=0; k<r; k++) {
+            Element *r0 = out + k*FFT_BATCH;
+            Element *r1 = out + (k + r)*FFT_BATCH;
+            Element *r2 = out + (k + 2*r)*FFT_BATCH;
+            for (u_int64_t c=0; c<nb; c++) {
+                Element x1, x2, t, d, m1, m2;
+                if (k) {
+                    f.mul(x1, r1[c], vp[k*step]);
+                    f.mul(x2, r2[c], vp[2*k*step]);
+                } else {
+                    f.copy(x1, r1[c]);
+                    f.copy(x2, r2[c]);
+                }
+                f.add(t, x1, x2);
+                f.sub(d, x1, x2);
+                f.mul(m1, t, h);
+                f.add(m1, m1, r0[c]);
+                f.mul(m2, d, c3);
+                f.add(r0[c], r0[c], t);
+                f.add(r1[c], m1, m2);
+                f.sub(r2[c], m1, m2);
+            }
+        }
+        return;
+    }
+
+    std::vector<Element> x(p);
+    std::vector<Element> y(p);
+    for (u_int64_t k=0; k<r; k++) {
+        for (u_int64_t c=0; c<nb; c++) {
+            for (u_int64_t t=0; t<p; t++) {
+                f.mul(x[t], out[(k + t*r)*FFT_BATCH + c], vp[t*k*step]);
+            }
+            for (u_int64_t q=0; q<p; q++) {
+                f.copy(y[q], x[0]);
+                for (u_int64_t t=1; t<p; t++) {
+                    Element e;
+                    f.mul(e, x[t], vp[((t*q) % p)*stepP]);
+                    f.add(y[q], y[q], e);
+                }
+            }
+            for (u_int64_t q=0; q<p; q++) f.copy(out[(k + q*r)*FFT_BATCH + c], y[q]);
+        }
+    }
+}
+
+// 1/n, n = 2^k*m with m odd
+template <typename Field>
+typename Field::Element FFT<Field>::domainSizeInv(u_int64_t n) {
+    u_int64_t n1 = n & (~n + 1);
+    Element r;
+    if (n1 == n) return powTwoInv[log2(n)];
+    f.fromUI(r, n / n1);
+    f.inv(r, r);
+    f.mul(r, r, powTwoInv[log2(n1)]);
+    return r;
+}
+
+// w[(1 << (s-1)) + j] = root(s, j), or its inverse, for 1 <= s <= domainPow and j < 2^(s-1):
+// the twiddles of each stage contiguous, in 2^domainPow elements.
+template <typename Field>
+void FFT<Field>::stageRoots(Element *w, u_int32_t domainPow, bool inverse) {
+    for (u_int32_t st=1; st<=domainPow; st++) {
+        u_int64_t m = (u_int64_t)1 << st;
+        Element *ws = w + (m >> 1);
+        ws[0] = f.one();
+        #pragma omp parallel for
+        for (u_int64_t j=1; j< (m >> 1); j++) {
+            f.copy(ws[j], root(st, inverse ? m - j : j));
+        }
+    }
+}
+
+// w[c] = root(s, j), or its inverse, for the butterflies i+c of a stage with sub transforms of
+// size 2^s (j = (i+c) mod 2^(s-1)). With two level tables the products are one mulBatch.
+template <typename Field>
+void FFT<Field>::stageTwiddles(Element *w, u_int32_t s, u_int64_t i, u_int64_t nb, bool inverse) {
+    u_int64_t m = (u_int64_t)1 << s;
+    u_int64_t shift = this->s - s;
+    if (roots) {
+        for (u_int64_t c=0; c<nb; c++) {
+            u_int64_t j = (i+c) & ((m >> 1) - 1);
+            f.copy(w[c], roots[(inverse ? (m - j) & (m - 1) : j) << shift]);
+        }
+        return;
+    }
+    Element wl[FFT_BATCH];
+    u_int64_t loMask = ((u_int64_t)1 << rootsLoPow) - 1;
+    for (u_int64_t c0=0; c0<nb; c0 += FFT_BATCH) {
+        u_int64_t nc = std::min((u_int64_t)FFT_BATCH, nb - c0);
+        for (u_int64_t c=0; c<nc; c++) {
+            u_int64_t j = (i+c0+c) & ((m >> 1) - 1);
+            u_int64_t idx = (inverse ? (m - j) & (m - 1) : j) << shift;
+            f.copy(w[c0+c], rootsHi[idx >> rootsLoPow]);
+            f.copy(wl[c], rootsLo[idx & loMask]);
+        }
+        f.mulBatch(w + c0, w + c0, wl, nc);
+    }
+}
+
+// Gentleman-Sande butterflies [from, to) of the stage with sub transforms of size 2^s:
+// a[k+j] = u + v, a[k+j+h] = (u - v)*w[j]. If w is NULL the twiddles come from stageTwiddles.
+template <typename Field>
+void FFT<Field>::difButterflies(Element *a, u_int64_t from, u_int64_t to, u_int32_t s, const Element *w) {
+    Element wb[FFT_BATCH];
+    Element x[FFT_BATCH];
+    Element t[FFT_BATCH];
+    Element u;
+    u_int64_t mdiv2 = (u_int64_t)1 << (s-1);
+    for (u_int64_t i0=from; i0<to; i0 += FFT_BATCH) {
+        u_int64_t nb = std::min((u_int64_t)FFT_BATCH, to - i0);
+        for (u_int64_t c=0; c<nb; c++) {
+            u_int64_t k=((i0+c) >> (s-1)) << s;
+            u_int64_t j=(i0+c) & (mdiv2-1);
+            if (w) f.copy(wb[c], w[j]);
+            f.copy(u, a[k+j]);
+            f.add(a[k+j], u, a[k+j+mdiv2]);
+            f.sub(x[c], u, a[k+j+mdiv2]);
+        }
+        if (!w) stageTwiddles(wb, s, i0, nb, false);
+        f.mulBatch(t, wb, x, nb);
+        for (u_int64_t c=0; c<nb; c++) {
+            u_int64_t k=((i0+c) >> (s-1)) << s;
+            u_int64_t j=(i0+c) & (mdiv2-1);
+            f.copy(a[k+j+mdiv2], t[c]);
+        }
+    }
+}
+
+// Cooley-Tukey butterflies t = a[k+j+h]*w[j], a[k+j] = u + t, a[k+j+h] = u - t, or with the
+// roots (inverse roots if inverse) of stageTwiddles if w is NULL. If scale is not NULL both
+// outputs are multiplied by it.
+template <typename Field>
+void FFT<Field>::ditButterflies(Element *a, u_int64_t from, u_int64_t to, u_int32_t s, const Element *w, bool inverse, const Element *scale) {
+    Element wb[FFT_BATCH];
+    Element x[FFT_BATCH];
+    Element t[FFT_BATCH];
+    Element sc[FFT_BATCH];
+    Element u;
+    u_int64_t mdiv2 = (u_int64_t)1 << (s-1);
+    if (scale) {
+        for (u_int64_t c=0; c<FFT_BATCH; c++) f.copy(sc[c], *scale);
+    }
+    for (u_int64_t i0=from; i0<to; i0 += FFT_BATCH) {
+        u_int64_t nb = std::min((u_int64_t)FFT_BATCH, to - i0);
+        for (u_int64_t c=0; c<nb; c++) {
+            u_int64_t k=((i0+c) >> (s-1)) << s;
+            u_int64_t j=(i0+c) & (mdiv2-1);
+            if (w) f.copy(wb[c], w[j]);
+            f.copy(x[c], a[k+j+mdiv2]);
+        }
+        if (!w) stageTwiddles(wb, s, i0, nb, inverse);
+        f.mulBatch(t, wb, x, nb);
+        for (u_int64_t c=0; c<nb; c++) {
+            u_int64_t k=((i0+c) >> (s-1)) << s;
+            u_int64_t j=(i0+c) & (mdiv2-1);
+            f.copy(u, a[k+j]);
+            f.add(a[k+j], u, t[c]);
+            f.sub(a[k+j+mdiv2], u, t[c]);
+        }
+        if (scale) {
+            for (u_int64_t c=0; c<nb; c++) {
+                u_int64_t k=((i0+c) >> (s-1)) << s;
+                u_int64_t j=(i0+c) & (mdiv2-1);
+                f.copy(x[c], a[k+j]);
+                f.copy(t[c], a[k+j+mdiv2]);
+            }
+            f.mulBatch(x, x, sc, nb);
+            f.mulBatch(t, t, sc, nb);
+            for (u_int64_t c=0; c<nb; c++) {
+                u_int64_t k=((i0+c) >> (s-1)) << s;
+                u_int64_t j=(i0+c) & (mdiv2-1);
+                f.copy(a[k+j], x[c]);
+                f.copy(a[k+j+mdiv2], t[c]);
+            }
+        }
+    }
+}
+
+// The stages with sub transforms bigger than FFT_SIXSTEP_MIN_BYTES are one parallel pass over
+// a each, with the twiddles of each batch from stageTwiddles. The smaller ones are done block by
+// block, all of them while the block is in the cache, with their twiddles copied out of roots
+// first so they are read sequentially.
+template <typename Field>
+void FFT<Field>::fftDIF(Element *a, u_int64_t n) {
+    u_int32_t domainPow = log2(n);
+    assert(((u_int64_t)1 << domainPow) == n);
+    u_int32_t blockPow = std::min(domainPow, log2(std::max((u_int64_t)2, (u_int64_t)FFT_SIXSTEP_MIN_BYTES / sizeof(Element))));
+    u_int64_t blockSize = (u_int64_t)1 << blockPow;
+
+    Element *w = new Element[blockSize];
+    stageRoots(w, blockPow, false);
+    for (u_int32_t s=domainPow; s>blockPow; s--) {
+        #pragma omp parallel for
+        for (u_int64_t i0=0; i0< (n>>1); i0 += FFT_BATCH) {
+            difButterflies(a, i0, std::min(i0 + FFT_BATCH, n>>1), s, NULL);
+        }
+    }
+    #pragma omp parallel for
+    for (u_int64_t b=0; b<n; b += blockSize) {
+        for (u_int32_t s=blockPow; s>=1; s--) {
+            difButterflies(a + b, 0, blockSize >> 1, s, w + ((u_int64_t)1 << (s-1)));
+        }
+    }
+    delete[] w;
+}
+
+template <typename Field>
+void FFT<Field>::ifftDIT(Element *a, u_int64_t n) {
+    u_int32_t domainPow = log2(n);
+    assert(((u_int64_t)1 << domainPow) == n);
+    u_int32_t blockPow = std::min(domainPow, log2(std::max((u_int64_t)2, (u_int64_t)FFT_SIXSTEP_MIN_BYTES / sizeof(Element))));
+    u_int64_t blockSize = (u_int64_t)1 << blockPow;
+    const Element *scale = &powTwoInv[domainPow];
+
+    Element *w = new Element[blockSize];
+    stageRoots(w, blockPow, true);
+    #pragma omp parallel for
+    for (u_int64_t b=0; b<n; b += blockSize) {
+        for (u_int32_t s=1; s<=blockPow; s++) {
+            ditButterflies(a + b, 0, blockSize >> 1, s, w + ((u_int64_t)1 << (s-1)), true, s == domainPow ? scale : NULL);
+        }
+    }
+    for (u_int32_t s=blockPow+1; s<=domainPow; s++) {
+        #pragma omp parallel for
+        for (u_int64_t i0=0; i0< (n>>1); i0 += FFT_BATCH) {
+            ditButterflies(a, i0, std::min(i0 + FFT_BATCH, n>>1), s, NULL, true, s == domainPow ? scale : NULL);
+        }
+    }
+    delete[] w;
+}
+
+// Tiles of COBRA per task
+#define FFT_TASK_TILES 16
+
+// Same result as fft, but every piece of work is an OpenMP task instead of a parallel loop per
+// stage: the bit reversal in groups of FFT_TASK_TILES tile pairs, then fftRecursiveTask. Called
+// from a parallel region the tasks go to its threads, so FFTs and other work started as tasks of
+// the same team share the cores, otherwise it opens its own region.
+template <typename Field>
+void FFT<Field>::fftRecursive(Element *a, u_int64_t n) {
+    u_int32_t domainPow = log2(n);
+    assert(((u_int64_t)1 << domainPow) == n);
+    u_int32_t leafPow = std::min(domainPow, log2(std::max((u_int64_t)2, (u_int64_t)FFT_SIXSTEP_MIN_BYTES / sizeof(Element))));
+    Element *w = new Element[(u_int64_t)1 << leafPow];
+    stageRoots(w, leafPow, false);
+
+    if (omp_in_parallel()) {
+        reversePermutationTasks(a, domainPow);
+        fftRecursiveTask(a, domainPow, leafPow, w);
+    } else {
+        #pragma omp parallel
+        #pragma omp single
+        {
+            reversePermutationTasks(a, domainPow);
+            fftRecursiveTask(a, domainPow, leafPow, w);
+        }
+    }
+    delete[] w;
+}
+
+template <typename Field>
+void FFT<Field>::reversePermutationTasks(Element *a, u_int32_t domainPow) {
+    u_int32_t q = cobraBits();
+    u_int64_t n = (u_int64_t)1 << domainPow;
+    if (domainPow < 2*q) {
+        for (u_int64_t i=0; i<n; i++) {
+            u_int64_t r = BR(i, domainPow);
+            if (i>r) f.swap(a[i], a[r]);
+        }
+        return;
+    }
+    u_int64_t nMid = (u_int64_t)1 << (domainPow - 2*q);
+    u_int64_t rowSize = (u_int64_t)1 << q;
+    std::vector<u_int64_t> brq(rowSize);
+    for (u_int64_t i=0; i<rowSize; i++) brq[i] = BR(i, q);
+    const u_int64_t *pbrq = brq.data();
+
+    for (u_int64_t mid0=0; mid0<nMid; mid0 += FFT_TASK_TILES) {
+        #pragma omp task firstprivate(mid0)
+        {
+            Element *t1 = new Element[rowSize*rowSize];
+            Element *t2 = new Element[rowSize*rowSize];
+            reverseTiles(a, domainPow, q, mid0, std::min(mid0 + FFT_TASK_TILES, nMid), t1, t2, pbrq);
+            delete[] t1;
+            delete[] t2;
+        }
+    }
+    #pragma omp taskwait
+}
+
+// Radix-2 DIT of 2^domainPow elements already in bit reversed order. Below 2^leafPow elements
+// (the size of the fftDIF blocks) all the stages run in the task, with the twiddles of
+// stageRoots in w. Above, the two halves are tasks and the last stage is split in tasks of
+// 2^(leafPow-1) butterflies.
+template <typename Field>
+void FFT<Field>::fftRecursiveTask(Element *a, u_int32_t domainPow, u_int32_t leafPow, const Element *w) {
+    u_int64_t n = (u_int64_t)1 << domainPow;
+    if (domainPow <= leafPow) {
+        for (u_int32_t s=1; s<=domainPow; s++) {
+            ditButterflies(a, 0, n >> 1, s, w + ((u_int64_t)1 << (s-1)), false, NULL);
+        }
+        return;
+    }
+
+    #pragma omp task
+    fftRecursiveTask(a, domainPow - 1, leafPow, w);
+    #pragma omp task
+    fftRecursiveTask(a + (n >> 1), domainPow - 1, leafPow, w);
+    #pragma omp taskwait
+
+    u_int64_t chunk = (u_int64_t)1 << (leafPow - 1);
+    for (u_int64_t i0=0; i0< (n>>1); i0 += chunk) {
+        #pragma omp task firstprivate(i0)
+        ditButterflies(a, i0, std::min(i0 + chunk, n>>1), domainPow, NULL, false, NULL);
+    }
+    #pragma omp taskwait
+}
+
+// Out of core FFT, the steps of fftSixStep on a vector read and written in blocks:
+//   1. Groups of columns, as many as fit in a buffer, are read (n2 reads of a piece of row),
+//      transformed and multiplied by the twiddles, and written back.
+//   2. Groups of rows, one read each.
+//   3. Transposition by pairs of tiles, and shuffleRowsOutOfCore if n2 = 2*n1.
+// The passes go through streamBlocks, so the vector is read and written 3 times (4 for odd
+// domainPow) while the buffers are maxMemory/4 bytes each.
+template <typename Field>
+void FFT<Field>::fftOutOfCore(int fd, u_int64_t n, u_int64_t maxMemory) {
+    OutOfCoreVector v = { fd, NULL };
+    fftOutOfCore(v, n, maxMemory);
+}
+
+template <typename Field>
+void FFT<Field>::fftOutOfCore(Element *a, u_int64_t n, u_int64_t maxMemory) {
+    OutOfCoreVector v = { -1, a };
+    fftOutOfCore(v, n, maxMemory);
+}
+
+template <typename Field>
+void FFT<Field>::OutOfCoreVector::read(Element *dst, u_int64_t idx, u_int64_t count) const {
+    if (mem) {
+        memcpy(dst, mem + idx, count*sizeof(Element));
+        return;
+    }
+    char *p = (char *)dst;
+    u_int64_t bytes = count*sizeof(Element);
+    off_t offset = (off_t)(idx*sizeof(Element));
+    while (bytes > 0) {
+        ssize_t r = pread(fd, p, bytes, offset);
+        if (r < 0) {
+            if (errno == EINTR) continue;
+            throw std::system_error(errno, std::generic_category(), "pread");
+        }
+        if (r == 0) throw std::system_error(EIO, std::generic_category(), "pread: file shorter than the vector");
+        p += r;
+        bytes -= r;
+        offset += r;
+    }
+}
+
+template <typename Field>
+void FFT<Field>::OutOfCoreVector::write(u_int64_t idx, const Element *src, u_int64_t count) const {
+    if (mem) {
+        memcpy(mem + idx, src, count*sizeof(Element));
+        return;
+    }
+    const char *p = (const char *)src;
+    u_int64_t bytes = count*sizeof(Element);
+    off_t offset = (off_t)(idx*sizeof(Element));
+    while (bytes > 0) {
+        ssize_t r = pwrite(fd, p, bytes, offset);
+        if (r < 0) {
+            if (errno == EINTR) continue;
+            throw std::system_error(errno, std::generic_category(), "pwrite");
+        }
+        p += r;
+        bytes -= r;
+        offset += r;
+    }
+}
+
+template <typename Field>
+void FFT<Field>::fftOutOfCore(const OutOfCoreVector &v, u_int64_t n, u_int64_t maxMemory) {
+    u_int32_t domainPow = log2(n);
+    assert(((u_int64_t)1 << domainPow) == n);
+    u_int64_t bufElems = maxMemory / 4 / sizeof(Element);
+
+    if (n <= bufElems) {
+        Element *a = new Element[n];
+        try {
+            v.read(a, 0, n);
+            fft(a, n);
+            v.write(0, a, n);
+        } catch (...) {
+            delete[] a;
+            throw;
+        }
+        delete[] a;
+        return;
+    }
+
+    u_int32_t pow1 = domainPow/2;
+    u_int32_t pow2 = domainPow - pow1;
+    u_int64_t n1 = (u_int64_t)1 << pow1;
+    u_int64_t n2 = (u_int64_t)1 << pow2;
+    if (bufElems < n2) throw std::invalid_argument("fftOutOfCore: maxMemory too small for a column");
+
+    Element *w1 = new Element[n1 >> 1];
+    Element *w2 = new Element[n2 >> 1];
+    blockRoots(w1, pow1);
+    blockRoots(w2, pow2);
+
+    // Columns j0 .. j0+nCols-1 of block b, in the buffer as nCols wide rows
+    u_int64_t nCols = std::min(n1, (u_int64_t)1 << log2(bufElems / n2));
+    auto loadCols = [&](Element *buff, u_int64_t b) {
+        for (u_int64_t k=0; k<n2; k++) v.read(buff + k*nCols, k*n1 + b*nCols, nCols);
+    };
+    auto storeCols = [&](Element *buff, u_int64_t b) {
+        for (u_int64_t k=0; k<n2; k++) v.write(k*n1 + b*nCols, buff + k*nCols, nCols);
+    };
+    auto fftCols = [&](Element *buff, u_int64_t b) {
+        #pragma omp parallel
+        {
+            Element *col = new Element[n2];
+            Element *tw = new Element[n2];
+            Element *bc = new Element[n2 >> 1];
+            #pragma omp for
+            for (u_int64_t c=0; c<nCols; c++) {
+                u_int64_t j = b*nCols + c;
+                f.copy(tw[0], f.one());
+                for (u_int32_t i=0; i<pow2; i++) {
+                    u_int64_t h = (u_int64_t)1 << i;
+                    const Element &r = root(domainPow, (j << i) & (n-1));
+                    for (u_int64_t l=0; l<h; l++) bc[l] = r;
+                    f.mulBatch(tw + h, tw, bc, h);
+                }
+                for (u_int64_t k=0; k<n2; k++) col[k] = buff[k*nCols + c];
+                fftBlock(col, pow2, w2);
+                f.mulBatch(col, col, tw, n2);
+                for (u_int64_t k=0; k<n2; k++) buff[k*nCols + c] = col[k];
+            }
+            delete[] col;
+            delete[] tw;
+            delete[] bc;
+        }
+    };
+
+    u_int64_t nRows = std::min(n2, (u_int64_t)1 << log2(bufElems / n1));
+    auto loadRows = [&](Element *buff, u_int64_t b) {
+        v.read(buff, b*nRows*n1, nRows*n1);
+    };
+    auto storeRows = [&](Element *buff, u_int64_t b) {
+        v.write(b*nRows*n1, buff, nRows*n1);
+    };
+    auto fftRows = [&](Element *buff, u_int64_t) {
+        #pragma omp parallel for
+        for (u_int64_t r=0; r<nRows; r++) fftBlock(buff + r*n1, pow1, w1);
+    };
+
+    try {
+        streamBlocks(n1 / nCols, nCols*n2, loadCols, fftCols, storeCols);
+        streamBlocks(n2 / nRows, nRows*n1, loadRows, fftRows, storeRows);
+        transposeSquareOutOfCore(v, 0, n1, bufElems);
+        if (n2 != n1) {
+            transposeSquareOutOfCore(v, n1*n1, n1, bufElems);
+            shuffleRowsOutOfCore(v, n2, n1);
+        }
+    } catch (...) {
+        delete[] w1;
+        delete[] w2;
+        throw;
+    }
+    delete[] w1;
+    delete[] w2;
+}
+
+// Runs load, process and store on the blocks 0 .. nBlocks-1 with three buffers of bufElems:
+// while block b is processed in the calling thread, block b+1 is loaded and block b-1 stored
+// in two other threads. Blocks must not overlap. The first exception stops the loop and is
+// rethrown once both threads are joined and the buffers freed.
+template <typename Field>
+void FFT<Field>::streamBlocks(u_int64_t nBlocks, u_int64_t bufElems,
+    const std::function<void(Element *, u_int64_t)> &load,
+    const std::function<void(Element *, u_int64_t)> &process,
+    const std::function<void(Element *, u_int64_t)> &store)
+{
+    Element *bufs[3] = { NULL, NULL, NULL };
+    std::exception_ptr loadError, processError, storeError;
+    auto run = [](const std::function<void(Element *, u_int64_t)> &fn, Element *buff, u_int64_t b, std::exception_ptr &error) {
+        try {
+            fn(buff, b);
+        } catch (...) {
+            error = std::current_exception();
+        }
+    };
+
+    std::thread loader, storer;
+    try {
+        for (int i=0; i<3; i++) bufs[i] = new Element[bufElems];
+        run(load, bufs[0], 0, loadError);
+        for (u_int64_t b=0; b<nBlocks && !loadError && !processError && !storeError; b++) {
+            Element *cur = bufs[b % 3];
+            if (b + 1 < nBlocks) loader = std::thread(run, std::cref(load), bufs[(b+1) % 3], b+1, std::ref(loadError));
+            run(process, cur, b, processError);
+            if (storer.joinable()) storer.join();
+            if (!storeError && !processError) storer = std::thread(run, std::cref(store), cur, b, std::ref(storeError));
+            if (loader.joinable()) loader.join();
+        }
+    } catch (...) {
+        // new or std::thread
+        processError = std::current_exception();
+    }
+    if (loader.joinable()) loader.join();
+    if (storer.joinable()) storer.join();
+
+    for (int i=0; i<3; i++) delete[] bufs[i];
+    if (processError) std::rethrow_exception(processError);
+    if (loadError) std::rethrow_exception(loadError);
+    if (storeError) std::rethrow_exception(storeError);
+}
+
+// Transposition of the m x m matrix at base, by pairs of t x t tiles (i, j), (j, i) that are
+// read, transposed in memory and written swapped, with the pairs streamed as streamBlocks blocks.
+template <typename Field>
+void FFT<Field>::transposeSquareOutOfCore(const OutOfCoreVector &v, u_int64_t base, u_int64_t m, u_int64_t bufElems) {
+    u_int64_t t = 1;
+    while (t < m && 2*(2*t)*(2*t) <= bufElems) t *= 2;
+    u_int64_t nt = m / t;
+    std::vector<std::pair<u_int64_t, u_int64_t> > pairs;
+    for (u_int64_t i=0; i<nt; i++) {
+        for (u_int64_t j=i; j<nt; j++) pairs.push_back(std::make_pair(i, j));
+    }
+
+    auto readTile = [&](Element *tile, u_int64_t i, u_int64_t j) {
+        for (u_int64_t r=0; r<t; r++) v.read(tile + r*t, base + (i*t + r)*m + j*t, t);
+    };
+    auto writeTile = [&](u_int64_t i, u_int64_t j, const Element *tile) {
+        for (u_int64_t r=0; r<t; r++) v.write(base + (i*t + r)*m + j*t, tile + r*t, t);
+    };
+    auto load = [&](Element *buff, u_int64_t b) {
+        readTile(buff, pairs[b].first, pairs[b].second);
+        if (pairs[b].first != pairs[b].second) readTile(buff + t*t, pairs[b].second, pairs[b].first);
+    };
+    auto process = [&](Element *buff, u_int64_t b) {
+        transposeSquare(buff, t);
+        if (pairs[b].first != pairs[b].second) transposeSquare(buff + t*t, t);
+    };
+    auto store = [&](Element *buff, u_int64_t b) {
+        writeTile(pairs[b].second, pairs[b].first, buff);
+        if (pairs[b].first != pairs[b].second) writeTile(pairs[b].first, pairs[b].second, buff + t*t);
+    };
+    streamBlocks(pairs.size(), 2*t*t, load, process, store);
+}
+
+// shuffleRows on the out of core vector, one row read and written at a time
+template <typename Field>
+void FFT<Field>::shuffleRowsOutOfCore(const OutOfCoreVector &v, u_int64_t nRows, u_int64_t rowSize) {
+    u_int64_t half = nRows >> 1;
+    std::vector<bool> visited(nRows, false);
+    Element *tmp = new Element[rowSize];
+    Element *row = new Element[rowSize];
+    try {
+        for (u_int64_t p=0; p<nRows; p++) {
+            if (visited[p]) continue;
+            visited[p] = true;
+            u_int64_t src = (p & 1) ? half + (p >> 1) : p >> 1;
+            if (src == p) continue;
+            v.read(tmp, p*rowSize, rowSize);
+            u_int64_t cur = p;
+            while (src != p) {
+                v.read(row, src*rowSize, rowSize);
+                v.write(cur*rowSize, row, rowSize);
+                visited[src] = true;
+                cur = src;
+                src = (cur & 1) ? half + (cur >> 1) : cur >> 1;
+            }
+            v.write(cur*rowSize, tmp, rowSize);
+        }
+    } catch (...) {
+        delete[] tmp;
+        delete[] row;
+        throw;
+    }
+    delete[] tmp;
+    delete[] row;
+}
+
 template <typename Field>
 void FFT<Field>::ifft(Element *a, u_int64_t n ) {
-    fft(a, n);
-    u_int64_t domainPow =log2(n);
-    u_int64_t nDiv2= n >> 1; 
+    ifftScaled(&a, 1, n, NULL);
+}
+
+template <typename Field>
+void FFT<Field>::ifft(Element **polys, u_int32_t nPolys, u_int64_t n) {
+    ifftScaled(polys, nPolys, n, NULL);
+}
+
+// ifft with the final division by n replaced by a multiplication by scale[i], if not NULL
+template <typename Field>
+void FFT<Field>::ifftScaled(Element **polys, u_int32_t nPolys, u_int64_t n, const Element *scale) {
+    fft(polys, nPolys, n);
+    Element nInv = domainSizeInv(n);
+    u_int64_t nSwaps = (n-1) >> 1;
     #pragma omp parallel for
-    for (u_int64_t i=1; i<nDiv2; i++) {
+    for (u_int64_t i=1; i<=nSwaps; i++) {
         Element tmp;
         u_int64_t r = n-i;
-        f.copy(tmp, a[i]);
-        f.mul(a[i], a[r], powTwoInv[domainPow]);
-        f.mul(a[r], tmp, powTwoInv[domainPow]);
+        for (u_int32_t p=0; p<nPolys; p++) {
+            Element *a = polys[p];
+            f.copy(tmp, a[i]);
+            f.copy(a[i], a[r]);
+            f.copy(a[r], tmp);
+        }
     } 
-    f.mul(a[0], a[0], powTwoInv[domainPow]);
-    f.mul(a[n >> 1], a[n >> 1], powTwoInv[domainPow]);
+    #pragma omp parallel for
+    for (u_int64_t i0=0; i0<n; i0 += FFT_BATCH) {
+        Element inv[FFT_BATCH];
+        u_int64_t nb = std::min((u_int64_t)FFT_BATCH, n - i0);
+        const Element *sc = scale ? &scale[i0] : inv;
+        if (!scale) {
+            for (u_int64_t c=0; c<nb; c++) f.copy(inv[c], nInv);
+        }
+        for (u_int32_t p=0; p<nPolys; p++) {
+            f.mulBatch(&polys[p][i0], &polys[p][i0], sc, nb);
+        }
+    }
+}
+
+template <typename Field>
+void FFT<Field>::cosetFft(Element *a, u_int64_t n, const Element &shift) {
+    std::shared_ptr<Element> scale = powersTable(n, f.one(), shift);
+    fftScaled(&a, 1, n, scale.get());
+}
+
+template <typename Field>
+void FFT<Field>::cosetFft(Element **polys, u_int32_t nPolys, u_int64_t n, const Element &shift) {
+    std::shared_ptr<Element> scale = powersTable(n, f.one(), shift);
+    fftScaled(polys, nPolys, n, scale.get());
+}
+
+// a(x) = sum b_k L_k(x/shift) where b = ifft(a), so the coefficients are b_i*shift^-i/n
+template <typename Field>
+void FFT<Field>::cosetIfft(Element *a, u_int64_t n, const Element &shift) {
+    Element shiftInv;
+    f.inv(shiftInv, shift);
+    std::shared_ptr<Element> scale = powersTable(n, domainSizeInv(n), shiftInv);
+    ifftScaled(&a, 1, n, scale.get());
+}
+
+template <typename Field>
+void FFT<Field>::cosetIfft(Element **polys, u_int32_t nPolys, u_int64_t n, const Element &shift) {
+    Element shiftInv;
+    f.inv(shiftInv, shift);
+    std::shared_ptr<Element> scale = powersTable(n, domainSizeInv(n), shiftInv);
+    ifftScaled(polys, nPolys, n, scale.get());
+}
+
+// Coefficients times shift^i/n from one ifft, zero padded and transformed in the big domain
+template <typename Field>
+void FFT<Field>::lde(Element *out, const Element *in, u_int64_t n, u_int32_t blowup, const Element &shift) {
+    u_int64_t nExt = n*blowup;
+    assert(log2(nExt) <= s);
+    if (out != in) {
+        #pragma omp parallel for
+        for (u_int64_t i=0; i<n; i++) f.copy(out[i], in[i]);
+    }
+    std::shared_ptr<Element> scale = powersTable(n, domainSizeInv(n), shift);
+    ifftScaled(&out, 1, n, scale.get());
+    #pragma omp parallel for
+    for (u_int64_t i=n; i<nExt; i++) f.copy(out[i], f.zero());
+    fft(out, nExt);
 }
 
 
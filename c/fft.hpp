@@ -1,31 +1,193 @@
 #ifndef FFT_H
 #define FFT_H
 
+#include <vector>
+#include <mutex>
+#include <memory>
+#include <string>
+#include <functional>
+
+/*
+    Roots of unity of a field, shared by all the FFT<Field> instances of the process.
+    roots[i] = w^i for i < 2^s, with w a primitive 2^s-th root, so a domain of 2^d <= 2^s
+    elements uses every 2^(s-d)-th one. The registry keeps the largest table computed so far
+    and FFTs hold a reference to the table they started with, so a new bigger table does not
+    invalidate them. If a file is set with setFile, tables are mapped from it when it is big
+    enough and written to it after they are computed otherwise.
+
+    With setCompressed(true) the tables computed afterwards keep two tables of about 2^(s/2)
+    elements instead, w^i = hi[i >> loPow]*lo[i & (2^loPow - 1)] and roots is NULL. They are
+    cheap to compute, so they are not saved to the file.
+*/
+template <typename Field>
+class FFTRoots {
+    typedef typename Field::Element Element;
+
+    void *mapped;
+    u_int64_t mappedSize;
+
+    FFTRoots() : mapped(NULL), mappedSize(0), roots(NULL), hi(NULL), lo(NULL), loPow(0), powTwoInv(NULL) {};
+    void compute(u_int32_t domainPow, bool compressed);
+    void computePowTwoInv();
+    bool load(const std::string &fileName, u_int32_t domainPow);
+    void save(const std::string &fileName);
+
+    static std::mutex &registryMutex();
+    static std::shared_ptr<FFTRoots> &largest();
+    static std::string &file();
+    static bool &compressedTables();
+
+public:
+    u_int32_t s;
+    Element nqr;
+    Element *roots;
+    Element *hi;
+    Element *lo;
+    u_int32_t loPow;
+    Element *powTwoInv;
+
+    ~FFTRoots();
+
+    // A table with at least 2^domainPow roots. Throws std::range_error if the field does not
+    // have them.
+    static std::shared_ptr<FFTRoots> get(u_int32_t domainPow);
+    // Empty fileName (the default) to keep the tables only in memory
+    static void setFile(const std::string &fileName);
+    // Drops the registry reference, the table is freed when the last FFT using it is destroyed
+    static void clear();
+    // Two level tables for the domains computed from now on
+    static void setCompressed(bool compressed);
+};
+
 template <typename Field>
 class FFT {
     Field f;
     typedef typename Field::Element Element;
 
+    // powers[i] = start*ratio^i for i < n
+    struct PowersTable {
+        u_int64_t n;
+        Element start;
+        Element ratio;
+        std::shared_ptr<Element> powers;
+    };
+
     u_int32_t s;
     Element nqr;
+    std::shared_ptr<FFTRoots<Field> > rootsTable;
     Element *roots;
+    Element *rootsHi;
+    Element *rootsLo;
+    u_int32_t rootsLoPow;
     Element *powTwoInv;
+    // oddRoots[i] = v^i for i < oddOrder, v a root of the odd part of maxDomainSize (the part
+    // the field has roots for)
+    u_int64_t oddOrder;
+    Element *oddRoots;
     u_int32_t nThreads;
+    // The last FFT_POWERS_TABLES tables used, the most recent at the end
+    std::vector<PowersTable> powersTables;
+    std::mutex powersMutex;
 
     void reversePermutationInnerLoop(Element *a, u_int64_t from, u_int64_t to, u_int32_t domainPow);
-    void reversePermutation(Element *a, u_int64_t n);
     void fftInnerLoop(Element *a, u_int64_t from, u_int64_t to, u_int32_t s);
     void finalInverseInner(Element *a, u_int64_t from, u_int64_t to, u_int32_t domainPow);
 
+    void blockRoots(Element *w, u_int32_t domainPow);
+    void fftBlock(Element *a, u_int32_t domainPow, const Element *w);
+    void transposeSquare(Element *a, u_int64_t n);
+    void shuffleRows(Element *a, u_int64_t nRows, u_int64_t rowSize);
+    void fftSixStep(Element **polys, u_int32_t nPolys, u_int64_t n, const Element *scale);
+    void fftScaled(Element **polys, u_int32_t nPolys, u_int64_t n, const Element *scale);
+    void ifftScaled(Element **polys, u_int32_t nPolys, u_int64_t n, const Element *scale);
+    std::shared_ptr<Element> powersTable(u_int64_t n, const Element &start, const Element &ratio);
+    void stageRoots(Element *w, u_int32_t domainPow, bool inverse);
+    void stageTwiddles(Element *w, u_int32_t s, u_int64_t i, u_int64_t nb, bool inverse);
+    void difButterflies(Element *a, u_int64_t from, u_int64_t to, u_int32_t s, const Element *w);
+    void ditButterflies(Element *a, u_int64_t from, u_int64_t to, u_int32_t s, const Element *w, bool inverse, const Element *scale);
+    u_int32_t cobraBits();
+    void reverseTiles(Element *a, u_int32_t domainPow, u_int32_t q, u_int64_t from, u_int64_t to, Element *t1, Element *t2, const u_int64_t *brq);
+    void reversePermutationTasks(Element *a, u_int32_t domainPow);
+    void fftRecursiveTask(Element *a, u_int32_t domainPow, u_int32_t leafPow, const Element *w);
+    void computeOddRoots(u_int64_t maxOdd);
+    void fftMixed(Element **polys, u_int32_t nPolys, u_int64_t n, const Element *scale);
+    void smallDft(Element *out, const Element *in, u_int64_t stride, u_int64_t m, const Element *vp, u_int64_t mv, u_int64_t nb);
+    Element domainSizeInv(u_int64_t n);
+
+    // Vector of fftOutOfCore, in the file fd if mem is NULL
+    struct OutOfCoreVector {
+        int fd;
+        Element *mem;
+        void read(Element *dst, u_int64_t idx, u_int64_t count) const;
+        void write(u_int64_t idx, const Element *src, u_int64_t count) const;
+    };
+    void fftOutOfCore(const OutOfCoreVector &v, u_int64_t n, u_int64_t maxMemory);
+    void streamBlocks(u_int64_t nBlocks, u_int64_t bufElems,
+        const std::function<void(Element *, u_int64_t)> &load,
+        const std::function<void(Element *, u_int64_t)> &process,
+        const std::function<void(Element *, u_int64_t)> &store);
+    void transposeSquareOutOfCore(const OutOfCoreVector &v, u_int64_t base, u_int64_t m, u_int64_t bufElems);
+    void shuffleRowsOutOfCore(const OutOfCoreVector &v, u_int64_t nRows, u_int64_t rowSize);
+
 public:
 
+    // Domains of 2^k elements up to maxDomainSize, and of 2^k*m if m divides the odd part of
+    // maxDomainSize and the field has roots of order m (r-1 of BN254 has 3^2, p-1 of Goldilocks
+    // 3*5*17*257*65537). fft, ifft, the coset transforms, lde and their batched versions take
+    // these sizes, the other transforms only powers of two.
     FFT(u_int64_t maxDomainSize, u_int32_t _nThreads = 0);
     ~FFT();
     void fft(Element *a, u_int64_t n );
     void ifft(Element *a, u_int64_t n );
 
+    // Transforms without the bit reversal pass, for fft -> pointwise operations -> ifft.
+    // fftDIF takes a in natural order and leaves the transform in bit reversed order,
+    // a[i] = fft(a)[BR(i)]. ifftDIT takes a in that bit reversed order and leaves the inverse
+    // transform, already divided by n, in natural order.
+    void fftDIF(Element *a, u_int64_t n);
+    void ifftDIT(Element *a, u_int64_t n);
+
+    // Same as fft, with the work split recursively (depth first) in OpenMP tasks instead of a
+    // parallel loop per stage. From inside a parallel region it runs on the threads of that
+    // region, so it can share them with other FFTs or multiexps started as tasks.
+    void fftRecursive(Element *a, u_int64_t n);
+
+    // fft of vectors that do not fit in memory: n elements in the memory format of Element,
+    // from the start of the file fd or at a (for example a mapping of a file), transformed in
+    // place with about maxMemory bytes of buffers. Throws std::system_error on I/O errors and
+    // std::invalid_argument if maxMemory cannot hold about 4*sqrt(n) elements.
+    void fftOutOfCore(int fd, u_int64_t n, u_int64_t maxMemory);
+    void fftOutOfCore(Element *a, u_int64_t n, u_int64_t maxMemory);
+
+    // a[i] <-> a[BR(i)], for fftDIF results that are needed in natural order
+    void reversePermutation(Element *a, u_int64_t n);
+
+    // Transforms on the coset shift*<w>: cosetFft leaves a(shift*w^k) in a[k] and cosetIfft is
+    // its inverse. The powers of shift are kept for the last few n and shift used, and multiplied
+    // in the first fft stage or in the final 1/n scaling of the ifft.
+    void cosetFft(Element *a, u_int64_t n, const Element &shift);
+    void cosetIfft(Element *a, u_int64_t n, const Element &shift);
+
+    // Low degree extension: in has the values of a polynomial of degree < n on the subgroup of
+    // size n, out (n*blowup elements) gets its values on shift times the subgroup of size
+    // n*blowup, in natural order. out can be in if the buffer has room for n*blowup elements.
+    void lde(Element *out, const Element *in, u_int64_t n, u_int32_t blowup, const Element &shift);
+
+    // The same transforms on nPolys vectors of size n together, as in the A, B and C of a
+    // Groth16 proof. The twiddles and the parallel loops are shared by all the vectors.
+    void fft(Element **polys, u_int32_t nPolys, u_int64_t n);
+    void ifft(Element **polys, u_int32_t nPolys, u_int64_t n);
+    void cosetFft(Element **polys, u_int32_t nPolys, u_int64_t n, const Element &shift);
+    void cosetIfft(Element **polys, u_int32_t nPolys, u_int64_t n, const Element &shift);
+
     u_int32_t log2(u_int64_t n);
-    inline Element &root(u_int32_t domainPow, u_int64_t idx) { return roots[ idx << (s-domainPow)]; }
+    inline Element root(u_int32_t domainPow, u_int64_t idx) {
+        u_int64_t i = idx << (s-domainPow);
+        if (roots) return roots[i];
+        Element r;
+        f.mul(r, rootsHi[i >> rootsLoPow], rootsLo[i & (((u_int64_t)1 << rootsLoPow) - 1)]);
+        return r;
+    }
 
     void printVector(Element *a, u_int64_t n );
 
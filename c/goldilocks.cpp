@@ -0,0 +1,394 @@
+#include <immintrin.h>
+#include <algorithm>
+#include <omp.h>
+#include "goldilocks.hpp"
+
+const uint64_t GoldilocksField::P;
+const uint64_t GoldilocksField::EPSILON;
+
+static int simdLevel = GoldilocksField::cpuSimd();
+
+GoldilocksField GoldilocksField::field;
+
+GoldilocksField::GoldilocksField() {
+    fZero.v = 0;
+    fOne.v = 1;
+    fNegOne.v = P - 1;
+}
+
+int GoldilocksField::cpuSimd() {
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) return SIMD_AVX512;
+    if (__builtin_cpu_supports("avx2")) return SIMD_AVX2;
+    return SIMD_NONE;
+}
+
+bool GoldilocksField::setSimd(int level) {
+    if ((level < SIMD_NONE)||(level > cpuSimd())) return false;
+    simdLevel = level;
+    return true;
+}
+
+int GoldilocksField::getSimd() {
+    return simdLevel;
+}
+
+GoldilocksField::Element GoldilocksField::set(int value) {
+    Element r;
+    set(r, value);
+    return r;
+}
+
+void GoldilocksField::set(Element &r, int value) {
+    r.v = value >= 0 ? (uint64_t)value : P - (uint64_t)(-(int64_t)value);
+}
+
+void GoldilocksField::fromString(Element &r, const std::string &s, uint32_t radix) {
+    mpz_t mr;
+    mpz_init_set_str(mr, s.c_str(), radix);
+    fromMpz(r, mr);
+    mpz_clear(mr);
+}
+
+std::string GoldilocksField::toString(const Element &a, uint32_t radix) {
+    mpz_t r;
+    mpz_init(r);
+    toMpz(r, a);
+    char *res = mpz_get_str(0, radix, r);
+    mpz_clear(r);
+    std::string resS(res);
+    free(res);
+    return resS;
+}
+
+void GoldilocksField::toMpz(mpz_t r, const Element &a) {
+    mpz_import(r, 1, -1, 8, -1, 0, (const void *)&a.v);
+}
+
+void GoldilocksField::fromMpz(Element &a, const mpz_t r) {
+    mpz_t m;
+    mpz_init(m);
+    mpz_import(m, 1, -1, 8, -1, 0, (const void *)&P);
+    mpz_mod(m, r, m);
+    uint64_t v = 0;
+    mpz_export((void *)&v, NULL, -1, 8, -1, 0, m);
+    a.v = v;
+    mpz_clear(m);
+}
+
+// Square and multiply, scalar in little endian
+void GoldilocksField::exp(Element &r, const Element &base, uint8_t* scalar, unsigned int scalarSize) {
+    Element b = base;
+    Element acc = fOne;
+    for (unsigned int i=0; i<scalarSize*8; i++) {
+        if ((scalar[i >> 3] >> (i & 7)) & 1) mul(acc, acc, b);
+        square(b, b);
+    }
+    r = acc;
+}
+
+// a^(p-2), 0 if a is 0
+void GoldilocksField::inv(Element &r, const Element &a) {
+    uint64_t e = P - 2;
+    exp(r, a, (uint8_t *)&e, sizeof(e));
+}
+
+void GoldilocksField::div(Element &r, const Element &a, const Element &b) {
+    Element ib;
+    inv(ib, b);
+    mul(r, a, ib);
+}
+
+int GoldilocksField::legendre(const Element &a) {
+    if (a.v == 0) return 0;
+    uint64_t e = (P - 1) >> 1;
+    Element r;
+    exp(r, a, (uint8_t *)&e, sizeof(e));
+    return r.v == 1 ? 1 : -1;
+}
+
+
+/*
+    Vector kernels. Each 64 bit lane is one element in canonical form.
+
+    The product uses four 32x32 bit multiplications per lane (there is no 64 bit one) and
+    then the same reduction as reduce128. AVX2 only has signed comparisons, so the unsigned
+    ones flip the sign bit of both operands.
+*/
+
+#define GL_AVX2 __attribute__((target("avx2")))
+#define GL_AVX512 __attribute__((target("avx512f")))
+
+static inline GL_AVX2 __m256i gl_ltu4(__m256i a, __m256i b) {
+    const __m256i sign = _mm256_set1_epi64x(0x8000000000000000LL);
+    return _mm256_cmpgt_epi64(_mm256_xor_si256(b, sign), _mm256_xor_si256(a, sign));
+}
+
+static inline GL_AVX2 __m256i gl_add4(__m256i a, __m256i b) {
+    const __m256i p = _mm256_set1_epi64x(GoldilocksField::P);
+    const __m256i s = _mm256_add_epi64(a, b);
+    // s - p if it overflowed or s >= p
+    const __m256i keep = _mm256_andnot_si256(gl_ltu4(s, a), gl_ltu4(s, p));
+    return _mm256_sub_epi64(s, _mm256_andnot_si256(keep, p));
+}
+
+static inline GL_AVX2 __m256i gl_sub4(__m256i a, __m256i b) {
+    const __m256i p = _mm256_set1_epi64x(GoldilocksField::P);
+    const __m256i d = _mm256_sub_epi64(a, b);
+    return _mm256_add_epi64(d, _mm256_and_si256(gl_ltu4(a, b), p));
+}
+
+static inline GL_AVX2 __m256i gl_mul4(__m256i a, __m256i b) {
+    const __m256i p = _mm256_set1_epi64x(GoldilocksField::P);
+    const __m256i eps = _mm256_set1_epi64x(GoldilocksField::EPSILON);
+    const __m256i aHi = _mm256_srli_epi64(a, 32);
+    const __m256i bHi = _mm256_srli_epi64(b, 32);
+    const __m256i ll = _mm256_mul_epu32(a, b);
+    const __m256i lh = _mm256_mul_epu32(a, bHi);
+    const __m256i hl = _mm256_mul_epu32(aHi, b);
+    const __m256i hh = _mm256_mul_epu32(aHi, bHi);
+
+    // a*b = hi*2^64 + lo
+    const __m256i mid = _mm256_add_epi64(lh, hl);
+    const __m256i c1 = gl_ltu4(mid, lh);
+    const __m256i lo = _mm256_add_epi64(ll, _mm256_slli_epi64(mid, 32));
+    const __m256i c2 = gl_ltu4(lo, ll);
+    __m256i hi = _mm256_add_epi64(hh, _mm256_srli_epi64(mid, 32));
+    hi = _mm256_add_epi64(hi, _mm256_and_si256(c1, _mm256_set1_epi64x(0x100000000LL)));
+    hi = _mm256_sub_epi64(hi, c2);
+
+    const __m256i hiHi = _mm256_srli_epi64(hi, 32);
+    const __m256i hiLo = _mm256_and_si256(hi, eps);
+    __m256i t0 = _mm256_sub_epi64(lo, hiHi);
+    t0 = _mm256_sub_epi64(t0, _mm256_and_si256(gl_ltu4(lo, hiHi), eps));
+    const __m256i t1 = _mm256_sub_epi64(_mm256_slli_epi64(hiLo, 32), hiLo);
+    __m256i r = _mm256_add_epi64(t0, t1);
+    r = _mm256_add_epi64(r, _mm256_and_si256(gl_ltu4(r, t1), eps));
+    return _mm256_sub_epi64(r, _mm256_andnot_si256(gl_ltu4(r, p), p));
+}
+
+static inline GL_AVX512 __m512i gl_add8(__m512i a, __m512i b) {
+    const __m512i p = _mm512_set1_epi64(GoldilocksField::P);
+    const __m512i s = _mm512_add_epi64(a, b);
+    const __mmask8 m = _mm512_cmplt_epu64_mask(s, a) | _mm512_cmpge_epu64_mask(s, p);
+    return _mm512_mask_sub_epi64(s, m, s, p);
+}
+
+static inline GL_AVX512 __m512i gl_sub8(__m512i a, __m512i b) {
+    const __m512i p = _mm512_set1_epi64(GoldilocksField::P);
+    const __m512i d = _mm512_sub_epi64(a, b);
+    return _mm512_mask_add_epi64(d, _mm512_cmplt_epu64_mask(a, b), d, p);
+}
+
+static inline GL_AVX512 __m512i gl_mul8(__m512i a, __m512i b) {
+    const __m512i p = _mm512_set1_epi64(GoldilocksField::P);
+    const __m512i eps = _mm512_set1_epi64(GoldilocksField::EPSILON);
+    const __m512i aHi = _mm512_srli_epi64(a, 32);
+    const __m512i bHi = _mm512_srli_epi64(b, 32);
+    const __m512i ll = _mm512_mul_epu32(a, b);
+    const __m512i lh = _mm512_mul_epu32(a, bHi);
+    const __m512i hl = _mm512_mul_epu32(aHi, b);
+    const __m512i hh = _mm512_mul_epu32(aHi, bHi);
+
+    const __m512i mid = _mm512_add_epi64(lh, hl);
+    const __m512i lo = _mm512_add_epi64(ll, _mm512_slli_epi64(mid, 32));
+    __m512i hi = _mm512_add_epi64(hh, _mm512_srli_epi64(mid, 32));
+    hi = _mm512_mask_add_epi64(hi, _mm512_cmplt_epu64_mask(mid, lh), hi, _mm512_set1_epi64(0x100000000LL));
+    hi = _mm512_mask_add_epi64(hi, _mm512_cmplt_epu64_mask(lo, ll), hi, _mm512_set1_epi64(1));
+
+    const __m512i hiHi = _mm512_srli_epi64(hi, 32);
+    const __m512i hiLo = _mm512_and_si512(hi, eps);
+    __m512i t0 = _mm512_sub_epi64(lo, hiHi);
+    t0 = _mm512_mask_sub_epi64(t0, _mm512_cmplt_epu64_mask(lo, hiHi), t0, eps);
+    const __m512i t1 = _mm512_sub_epi64(_mm512_slli_epi64(hiLo, 32), hiLo);
+    __m512i r = _mm512_add_epi64(t0, t1);
+    r = _mm512_mask_add_epi64(r, _mm512_cmplt_epu64_mask(r, t1), r, eps);
+    return _mm512_mask_sub_epi64(r, _mm512_cmpge_epu64_mask(r, p), r, p);
+}
+
+// op is 0: add, 1: sub, 2: mul. Returns the number of elements done, the tail is left to the caller.
+static GL_AVX2 uint64_t gl_batch4(int op, uint64_t *r, const uint64_t *a, const uint64_t *b, uint64_t n) {
+    uint64_t i = 0;
+    for (; i+4<=n; i+=4) {
+        const __m256i va = _mm256_loadu_si256((const __m256i *)(a+i));
+        const __m256i vb = _mm256_loadu_si256((const __m256i *)(b+i));
+        const __m256i vr = op == 0 ? gl_add4(va, vb) : (op == 1 ? gl_sub4(va, vb) : gl_mul4(va, vb));
+        _mm256_storeu_si256((__m256i *)(r+i), vr);
+    }
+    return i;
+}
+
+static GL_AVX512 uint64_t gl_batch8(int op, uint64_t *r, const uint64_t *a, const uint64_t *b, uint64_t n) {
+    uint64_t i = 0;
+    for (; i+8<=n; i+=8) {
+        const __m512i va = _mm512_loadu_si512((const void *)(a+i));
+        const __m512i vb = _mm512_loadu_si512((const void *)(b+i));
+        const __m512i vr = op == 0 ? gl_add8(va, vb) : (op == 1 ? gl_sub8(va, vb) : gl_mul8(va, vb));
+        _mm512_storeu_si512((void *)(r+i), vr);
+    }
+    return i;
+}
+
+static uint64_t gl_batch(int op, uint64_t *r, const uint64_t *a, const uint64_t *b, uint64_t n) {
+    if (simdLevel == GoldilocksField::SIMD_AVX512) return gl_batch8(op, r, a, b, n);
+    if (simdLevel == GoldilocksField::SIMD_AVX2) return gl_batch4(op, r, a, b, n);
+    return 0;
+}
+
+void GoldilocksField::addBatch(Element *r, const Element *a, const Element *b, uint64_t n) {
+    for (uint64_t i=gl_batch(0, &r->v, &a->v, &b->v, n); i<n; i++) add(r[i], a[i], b[i]);
+}
+
+void GoldilocksField::subBatch(Element *r, const Element *a, const Element *b, uint64_t n) {
+    for (uint64_t i=gl_batch(1, &r->v, &a->v, &b->v, n); i<n; i++) sub(r[i], a[i], b[i]);
+}
+
+void GoldilocksField::mulBatch(Element *r, const Element *a, const Element *b, uint64_t n) {
+    for (uint64_t i=gl_batch(2, &r->v, &a->v, &b->v, n); i<n; i++) mul(r[i], a[i], b[i]);
+}
+
+
+/*
+    FFT with radix-4 passes.
+
+    A pass does the stages s and s+1 of the radix-2 FFT together on the groups of 4h elements
+    (h = 2^(s-1)), so the data is read and written once per two stages. With w1 = root(s, j),
+    w2 = root(s+1, j) and w3 = root(s+1, j+h) = w2*root(4, 1):
+
+        b0 = a0 + w1*a1    b1 = a0 - w1*a1    b2 = a2 + w1*a3    b3 = a2 - w1*a3
+        a0 = b0 + w2*b2    a2 = b0 - w2*b2    a1 = b1 + w3*b3    a3 = b1 - w3*b3
+
+    The lanes take consecutive j, so the vector passes need h >= lanes. The smaller ones
+    (and the first stage when the number of stages is odd) are scalar.
+*/
+
+typedef GoldilocksField::Element GLElement;
+
+static void gl_radix4Scalar(GLElement *a, uint64_t n, uint64_t h, const GLElement *roots, uint64_t stride) {
+    GoldilocksField &f = GoldilocksField::field;
+    #pragma omp parallel for
+    for (uint64_t idx=0; idx<(n>>2); idx++) {
+        const uint64_t j = idx & (h-1);
+        GLElement *x = a + ((idx - j) << 2) + j;
+        const GLElement &w1 = roots[j*2*stride];
+        const GLElement &w2 = roots[j*stride];
+        const GLElement &w3 = roots[(j+h)*stride];
+        GLElement t1, t3, b0, b1, b2, b3;
+        f.mul(t1, w1, x[h]);
+        f.mul(t3, w1, x[3*h]);
+        f.add(b0, x[0], t1);
+        f.sub(b1, x[0], t1);
+        f.add(b2, x[2*h], t3);
+        f.sub(b3, x[2*h], t3);
+        f.mul(t1, w2, b2);
+        f.mul(t3, w3, b3);
+        f.add(x[0], b0, t1);
+        f.sub(x[2*h], b0, t1);
+        f.add(x[h], b1, t3);
+        f.sub(x[3*h], b1, t3);
+    }
+}
+
+static GL_AVX2 inline __m256i gl_twiddles4(const GLElement *roots, uint64_t j, uint64_t stride) {
+    if (stride == 1) return _mm256_loadu_si256((const __m256i *)(roots + j));
+    const __m256i idx = _mm256_set_epi64x(3*stride, 2*stride, stride, 0);
+    return _mm256_i64gather_epi64((const long long *)(roots + j*stride), idx, 8);
+}
+
+static GL_AVX2 void gl_radix4Avx2(GLElement *a, uint64_t n, uint64_t h, const GLElement *roots, uint64_t stride) {
+    #pragma omp parallel for
+    for (uint64_t idx=0; idx<(n>>2); idx+=4) {
+        const uint64_t j = idx & (h-1);
+        uint64_t *x = &a[((idx - j) << 2) + j].v;
+        const __m256i w1 = gl_twiddles4(roots, j, 2*stride);
+        const __m256i w2 = gl_twiddles4(roots, j, stride);
+        const __m256i w3 = gl_twiddles4(roots, j+h, stride);
+        const __m256i a0 = _mm256_loadu_si256((const __m256i *)(x));
+        const __m256i a1 = _mm256_loadu_si256((const __m256i *)(x+h));
+        const __m256i a2 = _mm256_loadu_si256((const __m256i *)(x+2*h));
+        const __m256i a3 = _mm256_loadu_si256((const __m256i *)(x+3*h));
+        const __m256i t1 = gl_mul4(w1, a1);
+        const __m256i t3 = gl_mul4(w1, a3);
+        const __m256i b0 = gl_add4(a0, t1);
+        const __m256i b1 = gl_sub4(a0, t1);
+        const __m256i b2 = gl_add4(a2, t3);
+        const __m256i b3 = gl_sub4(a2, t3);
+        const __m256i u2 = gl_mul4(w2, b2);
+        const __m256i u3 = gl_mul4(w3, b3);
+        _mm256_storeu_si256((__m256i *)(x), gl_add4(b0, u2));
+        _mm256_storeu_si256((__m256i *)(x+2*h), gl_sub4(b0, u2));
+        _mm256_storeu_si256((__m256i *)(x+h), gl_add4(b1, u3));
+        _mm256_storeu_si256((__m256i *)(x+3*h), gl_sub4(b1, u3));
+    }
+}
+
+static GL_AVX512 inline __m512i gl_twiddles8(const GLElement *roots, uint64_t j, uint64_t stride) {
+    if (stride == 1) return _mm512_loadu_si512((const void *)(roots + j));
+    const __m512i idx = _mm512_set_epi64(7*stride, 6*stride, 5*stride, 4*stride, 3*stride, 2*stride, stride, 0);
+    return _mm512_i64gather_epi64(idx, (const void *)(roots + j*stride), 8);
+}
+
+static GL_AVX512 void gl_radix4Avx512(GLElement *a, uint64_t n, uint64_t h, const GLElement *roots, uint64_t stride) {
+    #pragma omp parallel for
+    for (uint64_t idx=0; idx<(n>>2); idx+=8) {
+        const uint64_t j = idx & (h-1);
+        uint64_t *x = &a[((idx - j) << 2) + j].v;
+        const __m512i w1 = gl_twiddles8(roots, j, 2*stride);
+        const __m512i w2 = gl_twiddles8(roots, j, stride);
+        const __m512i w3 = gl_twiddles8(roots, j+h, stride);
+        const __m512i a0 = _mm512_loadu_si512((const void *)(x));
+        const __m512i a1 = _mm512_loadu_si512((const void *)(x+h));
+        const __m512i a2 = _mm512_loadu_si512((const void *)(x+2*h));
+        const __m512i a3 = _mm512_loadu_si512((const void *)(x+3*h));
+        const __m512i t1 = gl_mul8(w1, a1);
+        const __m512i t3 = gl_mul8(w1, a3);
+        const __m512i b0 = gl_add8(a0, t1);
+        const __m512i b1 = gl_sub8(a0, t1);
+        const __m512i b2 = gl_add8(a2, t3);
+        const __m512i b3 = gl_sub8(a2, t3);
+        const __m512i u2 = gl_mul8(w2, b2);
+        const __m512i u3 = gl_mul8(w3, b3);
+        _mm512_storeu_si512((void *)(x), gl_add8(b0, u2));
+        _mm512_storeu_si512((void *)(x+2*h), gl_sub8(b0, u2));
+        _mm512_storeu_si512((void *)(x+h), gl_add8(b1, u3));
+        _mm512_storeu_si512((void *)(x+3*h), gl_sub8(b1, u3));
+    }
+}
+
+template <>
+void FFT<GoldilocksField>::fft(GoldilocksField::Element *a, u_int64_t n) {
+    // The radix-4 passes read the roots table directly, two level tables and mixed radix
+    // domains use the generic code
+    if ((!roots)||(n & (n-1))) {
+        fftScaled(&a, 1, n, NULL);
+        return;
+    }
+    reversePermutation(a, n);
+    u_int32_t domainPow = log2(n);
+    assert(((u_int64_t)1 << domainPow) == n);
+
+    u_int32_t st = 1;
+    if (domainPow & 1) {
+        // First stage alone, all the roots are 1
+        #pragma omp parallel for
+        for (u_int64_t i=0; i<n; i+=2) {
+            Element u = a[i];
+            f.add(a[i], u, a[i+1]);
+            f.sub(a[i+1], u, a[i+1]);
+        }
+        st = 2;
+    }
+    const int simd = GoldilocksField::getSimd();
+    for (; st<domainPow; st+=2) {
+        const u_int64_t h = (u_int64_t)1 << (st-1);
+        // root(st+1, j) = roots[j*stride] and root(st, j) = roots[j*2*stride]
+        const u_int64_t stride = (u_int64_t)1 << (s - st - 1);
+        if ((simd == GoldilocksField::SIMD_AVX512)&&(h >= 8)) {
+            gl_radix4Avx512(a, n, h, roots, stride);
+        } else if ((simd >= GoldilocksField::SIMD_AVX2)&&(h >= 4)) {
+            gl_radix4Avx2(a, n, h, roots, stride);
+        } else {
+            gl_radix4Scalar(a, n, h, roots, stride);
+        }
+    }
+}
@@ -0,0 +1,131 @@
+#ifndef GOLDILOCKS_H
+#define GOLDILOCKS_H
+
+#include <cstdint>
+#include <cassert>
+#include <stdexcept>
+#include <iostream>
+#include <string>
+#include <gmp.h>
+
+/*
+    Field of the 64 bit prime p = 2^64 - 2^32 + 1.
+
+    Same interface as the generated Raw fields, so it can be used in FFT<>, but the elements
+    are a single word in canonical form (not Montgomery) and the product is reduced with
+    2^64 = 2^32 - 1 and 2^96 = -1 (mod p). The batch functions work on 4 (AVX2) or 8 (AVX-512)
+    elements per instruction when the CPU has them.
+*/
+class GoldilocksField {
+
+public:
+    const static int N64 = 1;
+    const static int MaxBits = 64;
+
+    const static uint64_t P = 0xFFFFFFFF00000001ULL;
+    const static uint64_t EPSILON = 0xFFFFFFFFULL;     // 2^64 - p
+
+    // Vector backend of the batch functions and the FFT
+    const static int SIMD_NONE = 0;
+    const static int SIMD_AVX2 = 1;
+    const static int SIMD_AVX512 = 2;
+
+    struct Element {
+        uint64_t v;
+    };
+
+private:
+    Element fZero;
+    Element fOne;
+    Element fNegOne;
+
+    static inline uint64_t reduce128(unsigned __int128 x) {
+        const uint64_t lo = (uint64_t)x;
+        const uint64_t hi = (uint64_t)(x >> 64);
+        const uint64_t hiHi = hi >> 32;
+        const uint64_t hiLo = hi & EPSILON;
+        uint64_t t0 = lo - hiHi;            // - hiHi*2^96
+        if (lo < hiHi) t0 -= EPSILON;
+        const uint64_t t1 = hiLo * EPSILON; // + hiLo*2^64
+        uint64_t r = t0 + t1;
+        if (r < t1) r += EPSILON;
+        return r >= P ? r - P : r;
+    }
+
+public:
+
+    GoldilocksField();
+
+    const Element &zero() { return fZero; };
+    const Element &one() { return fOne; };
+    const Element &negOne() { return fNegOne; };
+    Element set(int value);
+    void set(Element &r, int value);
+
+    void fromString(Element &r, const std::string &n, uint32_t radix = 10);
+    std::string toString(const Element &a, uint32_t radix = 10);
+
+    void inline copy(Element &r, const Element &a) { r.v = a.v; };
+    void inline swap(Element &a, Element &b) { uint64_t t = a.v; a.v = b.v; b.v = t; };
+    void inline add(Element &r, const Element &a, const Element &b) {
+        uint64_t s = a.v + b.v;
+        r.v = ((s < a.v)||(s >= P)) ? s - P : s;
+    };
+    void inline sub(Element &r, const Element &a, const Element &b) {
+        uint64_t d = a.v - b.v;
+        r.v = (a.v < b.v) ? d + P : d;
+    };
+    void inline neg(Element &r, const Element &a) { r.v = a.v ? P - a.v : 0; };
+    void inline mul(Element &r, const Element &a, const Element &b) { r.v = reduce128((unsigned __int128)a.v * b.v); };
+    void inline square(Element &r, const Element &a) { mul(r, a, a); };
+    void inline mul1(Element &r, const Element &a, uint64_t b) { r.v = reduce128((unsigned __int128)a.v * b); };
+
+    Element inline add(const Element &a, const Element &b) { Element r; add(r, a, b); return r; };
+    Element inline sub(const Element &a, const Element &b) { Element r; sub(r, a, b); return r; };
+    Element inline mul(const Element &a, const Element &b) { Element r; mul(r, a, b); return r; };
+    Element inline neg(const Element &a) { Element r; neg(r, a); return r; };
+    Element inline square(const Element &a) { Element r; square(r, a); return r; };
+
+    // r[i] = a[i] op b[i] for i < n, r can be a or b
+    void addBatch(Element *r, const Element *a, const Element *b, uint64_t n);
+    void subBatch(Element *r, const Element *a, const Element *b, uint64_t n);
+    void mulBatch(Element *r, const Element *a, const Element *b, uint64_t n);
+
+    void inv(Element &r, const Element &a);
+    void div(Element &r, const Element &a, const Element &b);
+    void exp(Element &r, const Element &base, uint8_t* scalar, unsigned int scalarSize);
+
+    // 1 if a is a non zero square, -1 if it is not a square and 0 if it is 0
+    int legendre(const Element &a);
+    bool inline isSquare(const Element &a) { return legendre(a) >= 0; };
+
+    // The elements are already in normal form, these are copies
+    void inline toMontgomery(Element &r, const Element &a) { r.v = a.v; };
+    void inline fromMontgomery(Element &r, const Element &a) { r.v = a.v; };
+
+    int inline eq(const Element &a, const Element &b) { return a.v == b.v; };
+    int inline isZero(const Element &a) { return a.v == 0; };
+
+    void toMpz(mpz_t r, const Element &a);
+    void fromMpz(Element &a, const mpz_t r);
+
+    int bytes ( void ) { return 8; };
+
+    void fromUI(Element &r, unsigned long int v) { r.v = v >= P ? v - P : v; };
+
+    // SIMD_AVX512 if the CPU has AVX-512F, SIMD_AVX2 if it has AVX2, SIMD_NONE otherwise
+    static int cpuSimd();
+    // Returns false if the CPU does not support it. Must not be called while other threads use the field.
+    static bool setSimd(int level);
+    static int getSimd();
+
+    static GoldilocksField field;
+};
+
+#include "fft.hpp"
+
+// Radix-4 passes over the AVX2/AVX-512 batch kernels (goldilocks.cpp)
+template <>
+void FFT<GoldilocksField>::fft(GoldilocksField::Element *a, u_int64_t n);
+
+#endif // GOLDILOCKS_H
@@ -0,0 +1,122 @@
+#include <random>
+#include <omp.h>
+
+namespace Groth16 {
+
+template <typename Engine>
+BatchVerifier<Engine>::BatchVerifier(Engine &_E, BnPairing<Engine> &_pairing, ZKeyUtils::Header *zkey, G1PointAffine *_IC) : E(_E), pairing(_pairing) {
+    E.g1.copy(vk_alpha1, *(G1PointAffine *)zkey->vk_alpha1);
+    E.g2.copy(vk_beta2, *(G2PointAffine *)zkey->vk_beta2);
+    E.g2.copy(vk_gamma2, *(G2PointAffine *)zkey->vk_gamma2);
+    E.g2.copy(vk_delta2, *(G2PointAffine *)zkey->vk_delta2);
+    IC = _IC;
+    nPublic = zkey->nPublic;
+}
+
+template <typename Engine>
+BatchVerifier<Engine>::BatchVerifier(Engine &_E, BnPairing<Engine> &_pairing,
+                                     G1PointAffine &alpha1, G2PointAffine &beta2, G2PointAffine &gamma2, G2PointAffine &delta2,
+                                     G1PointAffine *_IC, uint32_t _nPublic) : E(_E), pairing(_pairing) {
+    E.g1.copy(vk_alpha1, alpha1);
+    E.g2.copy(vk_beta2, beta2);
+    E.g2.copy(vk_gamma2, gamma2);
+    E.g2.copy(vk_delta2, delta2);
+    IC = _IC;
+    nPublic = _nPublic;
+}
+
+// Random non zero 128 bit coefficient in Montgomery form.
+template <typename Engine>
+void BatchVerifier<Engine>::randomCoefficient(FrElement &r) {
+    static std::random_device rd;
+    do {
+        E.fr.copy(r, E.fr.zero());
+        r.v[0] = ((uint64_t)rd() << 32) | rd();
+        r.v[1] = ((uint64_t)rd() << 32) | rd();
+    } while (E.fr.isZero(r));
+    E.fr.toMontgomery(r, r);
+}
+
+template <typename Engine>
+bool BatchVerifier<Engine>::verify(Proof *proofs, FrElement *publicInputs, uint64_t nProofs, uint32_t nThreads) {
+    if (nProofs == 0) return true;
+
+    uint32_t sBytes = E.fr.bytes();
+
+    FrElement *coefs = new FrElement[nProofs];
+    FrElement *icScalars = new FrElement[nPublic+1];
+
+    // The first coefficient can be 1 without loss of soundness.
+    E.fr.copy(coefs[0], E.fr.one());
+    for (uint64_t j=1; j<nProofs; j++) randomCoefficient(coefs[j]);
+
+    E.fr.copy(icScalars[0], E.fr.zero());
+    for (uint64_t j=0; j<nProofs; j++) {
+        E.fr.add(icScalars[0], icScalars[0], coefs[j]);
+    }
+
+    #pragma omp parallel for
+    for (uint32_t i=0; i<nPublic; i++) {
+        FrElement tmp;
+        E.fr.copy(icScalars[i+1], E.fr.zero());
+        for (uint64_t j=0; j<nProofs; j++) {
+            E.fr.mul(tmp, coefs[j], publicInputs[j*nPublic + i]);
+            E.fr.add(icScalars[i+1], icScalars[i+1], tmp);
+        }
+    }
+
+    G1PointAffine *ps = new G1PointAffine[nProofs+3];
+    G2PointAffine *qs = new G2PointAffine[nProofs+3];
+
+    // -sum(r_j)*alpha
+    FrElement sumR;
+    E.fr.fromMontgomery(sumR, icScalars[0]);
+    G1Point alphaR;
+    E.g1.mulByScalar(alphaR, vk_alpha1, (uint8_t *)&sumR, sBytes);
+    E.g1.neg(ps[nProofs], alphaR);
+    E.g2.copy(qs[nProofs], vk_beta2);
+
+    for (uint32_t i=0; i<=nPublic; i++) {
+        E.fr.fromMontgomery(icScalars[i], icScalars[i]);
+    }
+    for (uint64_t j=0; j<nProofs; j++) {
+        E.fr.fromMontgomery(coefs[j], coefs[j]);
+    }
+
+    // -sum(r_j*L_j)
+    G1Point L;
+    E.g1.multiMulByScalar(L, IC, (uint8_t *)icScalars, sBytes, nPublic+1, nThreads);
+    E.g1.neg(ps[nProofs+1], L);
+    E.g2.copy(qs[nProofs+1], vk_gamma2);
+
+    // -sum(r_j*C_j)
+    G1PointAffine *cs = new G1PointAffine[nProofs];
+    for (uint64_t j=0; j<nProofs; j++) {
+        E.g1.copy(cs[j], proofs[j].C);
+    }
+    G1Point C;
+    E.g1.multiMulByScalar(C, cs, (uint8_t *)coefs, sBytes, nProofs, nThreads);
+    E.g1.neg(ps[nProofs+2], C);
+    E.g2.copy(qs[nProofs+2], vk_delta2);
+    delete[] cs;
+
+    // r_j*A_j, B_j
+    #pragma omp parallel for
+    for (uint64_t j=0; j<nProofs; j++) {
+        G1Point tmp;
+        E.g1.mulByScalar(tmp, proofs[j].A, (uint8_t *)&coefs[j], sBytes);
+        E.g1.copy(ps[j], tmp);
+        E.g2.copy(qs[j], proofs[j].B);
+    }
+
+    bool res = pairing.pairingCheck(ps, qs, nProofs+3, nThreads);
+
+    delete[] ps;
+    delete[] qs;
+    delete[] icScalars;
+    delete[] coefs;
+
+    return res;
+}
+
+}  // namespace
@@ -0,0 +1,65 @@
+#ifndef GROTH16_VERIFIER_H
+#define GROTH16_VERIFIER_H
+
+#include "zkey_utils.hpp"
+#include "pairing.hpp"
+
+namespace Groth16 {
+
+/*
+    Verifies many proofs of the same circuit at once.
+
+    Each proof must satisfy:
+        e(A, B) = e(alpha, beta) * e(L, gamma) * e(C, delta)     with L = IC[0] + sum(pub[i]*IC[i+1])
+
+    The proofs are combined with random coefficients r_j:
+        prod(e(r_j*A_j, B_j)) * e(-sum(r_j)*alpha, beta) * e(-sum(r_j*L_j), gamma) * e(-sum(r_j*C_j), delta) == 1
+
+    sum(r_j*L_j) is a single multiexp over IC and sum(r_j*C_j) a single multiexp over the Cs,
+    so a batch of N proofs costs N+3 Miller loops and one final exponentiation.
+*/
+template <typename Engine>
+class BatchVerifier {
+
+    typedef typename Engine::FrElement FrElement;
+    typedef typename Engine::G1Point G1Point;
+    typedef typename Engine::G1PointAffine G1PointAffine;
+    typedef typename Engine::G2PointAffine G2PointAffine;
+
+public:
+    struct Proof {
+        G1PointAffine A;
+        G2PointAffine B;
+        G1PointAffine C;
+    };
+
+private:
+    Engine &E;
+    BnPairing<Engine> &pairing;
+
+    G1PointAffine vk_alpha1;
+    G2PointAffine vk_beta2;
+    G2PointAffine vk_gamma2;
+    G2PointAffine vk_delta2;
+    G1PointAffine *IC;
+    uint32_t nPublic;
+
+    void randomCoefficient(FrElement &r);
+
+public:
+
+    // IC has nPublic+1 points. The points are in the zkey (Montgomery) representation.
+    BatchVerifier(Engine &_E, BnPairing<Engine> &_pairing, ZKeyUtils::Header *zkey, G1PointAffine *_IC);
+    BatchVerifier(Engine &_E, BnPairing<Engine> &_pairing,
+                  G1PointAffine &alpha1, G2PointAffine &beta2, G2PointAffine &gamma2, G2PointAffine &delta2,
+                  G1PointAffine *_IC, uint32_t _nPublic);
+
+    // publicInputs holds nProofs*nPublic elements, nPublic for each proof.
+    bool verify(Proof *proofs, FrElement *publicInputs, uint64_t nProofs, uint32_t nThreads = 0);
+};
+
+}  // namespace
+
+#include "groth16_verifier.cpp"
+
+#endif // GROTH16_VERIFIER_H
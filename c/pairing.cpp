@@ -0,0 +1,376 @@
+#include <omp.h>
+
+template <typename Engine>
+BnPairing<Engine>::BnPairing(Engine &_E, std::string us) : E(_E) {
+    mpz_init_set_str(u, us.c_str(), 10);
+
+    // 6u+2
+    mpz_init(ateLoopCount);
+    mpz_mul_ui(ateLoopCount, u, 6);
+    mpz_add_ui(ateLoopCount, ateLoopCount, 2);
+
+    mpz_t k;
+    mpz_init_set(k, u);
+    while (mpz_sgn(k) > 0) {
+        int8_t d = 0;
+        if (mpz_odd_p(k)) {
+            d = 2 - (int8_t)mpz_fdiv_ui(k, 4);
+            if (d == 1) mpz_sub_ui(k, k, 1); else mpz_add_ui(k, k, 1);
+        }
+        uNaf.push_back(d);
+        mpz_fdiv_q_2exp(k, k, 1);
+    }
+    mpz_clear(k);
+
+    mpz_t q;
+    mpz_t qk;
+    mpz_t e;
+    mpz_init(q);
+    mpz_init(qk);
+    mpz_init(e);
+
+    E.f1.toMpz(q, E.f1.negOne());
+    mpz_add_ui(q, q, 1);
+
+    mpz_set_ui(qk, 1);
+    for (int k=1; k<4; k++) {
+        mpz_mul(qk, qk, q);
+        for (int j=0; j<6; j++) {
+            mpz_sub_ui(e, qk, 1);
+            mpz_mul_ui(e, e, j);
+            mpz_divexact_ui(e, e, 6);
+            expF2(frobeniusCoefs[k][j], E.f6.nonResidue(), e);
+        }
+    }
+
+    mpz_clear(q);
+    mpz_clear(qk);
+    mpz_clear(e);
+}
+
+template <typename Engine>
+BnPairing<Engine>::~BnPairing() {
+    mpz_clear(u);
+    mpz_clear(ateLoopCount);
+}
+
+template <typename Engine>
+void BnPairing<Engine>::expF2(F2Element &r, F2Element &base, mpz_t e) {
+    F2Element copyBase;
+    E.f2.copy(copyBase, base);
+    E.f2.copy(r, E.f2.one());
+    for (int i=mpz_sizeinbase(e, 2)-1; i>=0; i--) {
+        E.f2.square(r, r);
+        if (mpz_tstbit(e, i)) {
+            E.f2.mul(r, r, copyBase);
+        }
+    }
+}
+
+template <typename Engine>
+void inline BnPairing<Engine>::mulByF1(F2Element &r, F2Element &a, F1Element &b) {
+    E.f1.mul(r.a, a.a, b);
+    E.f1.mul(r.b, a.b, b);
+}
+
+template <typename Engine>
+void inline BnPairing<Engine>::conjugateF2(F2Element &r, F2Element &a) {
+    E.f1.copy(r.a, a.a);
+    E.f1.neg(r.b, a.b);
+}
+
+/*
+    (sum a_j*w^j)^(q^k) = sum a_j^(q^k) * nr6^(j*(q^k-1)/6) * w^j
+    Coefficient j of w^j is stored in: j=0: a.a, j=2: a.b, j=4: a.c, j=1: b.a, j=3: b.b, j=5: b.c
+*/
+template <typename Engine>
+void BnPairing<Engine>::frobenius(F12Element &r, F12Element &a, int k) {
+    F2Element *c[6] = { &r.a.a, &r.b.a, &r.a.b, &r.b.b, &r.a.c, &r.b.c };
+    F2Element *s[6] = { &a.a.a, &a.b.a, &a.a.b, &a.b.b, &a.a.c, &a.b.c };
+    for (int j=0; j<6; j++) {
+        if (k & 1) {
+            conjugateF2(*c[j], *s[j]);
+        } else {
+            E.f2.copy(*c[j], *s[j]);
+        }
+        if (j>0) E.f2.mul(*c[j], *c[j], frobeniusCoefs[k][j]);
+    }
+}
+
+/*
+    The twisted point is untwisted as (x*w^2, y*w^3) so:
+    pi^k(x, y) = (x^(q^k) * nr6^((q^k-1)/3), y^(q^k) * nr6^((q^k-1)/2))
+*/
+template <typename Engine>
+void BnPairing<Engine>::frobeniusG2(G2PointAffine &r, G2PointAffine &a, int k) {
+    if (k & 1) {
+        conjugateF2(r.x, a.x);
+        conjugateF2(r.y, a.y);
+    } else {
+        E.f2.copy(r.x, a.x);
+        E.f2.copy(r.y, a.y);
+    }
+    E.f2.mul(r.x, r.x, frobeniusCoefs[k][2]);
+    E.f2.mul(r.y, r.y, frobeniusCoefs[k][3]);
+}
+
+/*
+    Doubles t (XYZZ coordinates, a=0) and multiplies f by the tangent line evaluated at p.
+
+    U = 2*Y1
+    V = U^2
+    W = U*V
+    S = X1*V
+    M = 3*X1^2
+
+    The line yp - l*xp*w + (l*x1 - y1)*w^3, with l = M*ZZ1/(U*ZZZ1), scaled by U*ZZZ1:
+        c0 = U*ZZZ1*yp
+        c3 = -M*ZZ1*xp
+        c4 = M*X1 - U*Y1
+
+    X3 = M^2-2*S
+    Y3 = M*(S-X3)-W*Y1
+    ZZ3 = V*ZZ1
+    ZZZ3 = W*ZZZ1
+*/
+template <typename Engine>
+void BnPairing<Engine>::doublingStep(G2Point &t, F12Element &f, G1PointAffine &p) {
+    F2Element U, V, W, S, M, tmp;
+    F2Element c0, c3, c4;
+
+    E.f2.add(U, t.y, t.y);
+    E.f2.square(V, U);
+    E.f2.mul(W, U, V);
+    E.f2.mul(S, t.x, V);
+    E.f2.square(M, t.x);
+    E.f2.add(tmp, M, M);
+    E.f2.add(M, M, tmp);
+
+    E.f2.mul(c0, U, t.zzz);
+    mulByF1(c0, c0, p.y);
+    E.f2.mul(c3, M, t.zz);
+    mulByF1(c3, c3, p.x);
+    E.f2.neg(c3, c3);
+    E.f2.mul(c4, M, t.x);
+    E.f2.mul(tmp, U, t.y);
+    E.f2.sub(c4, c4, tmp);
+
+    E.f12.mulBy034(f, f, c0, c3, c4);
+
+    E.f2.mul(tmp, W, t.y);
+    E.f2.square(t.x, M);
+    E.f2.sub(t.x, t.x, S);
+    E.f2.sub(t.x, t.x, S);
+    E.f2.sub(t.y, S, t.x);
+    E.f2.mul(t.y, M, t.y);
+    E.f2.sub(t.y, t.y, tmp);
+    E.f2.mul(t.zz, V, t.zz);
+    E.f2.mul(t.zzz, W, t.zzz);
+}
+
+/*
+    Adds q to t (XYZZ coordinates) and multiplies f by the line through both evaluated at p.
+
+    U2 = X2*ZZ1
+    S2 = Y2*ZZZ1
+    P = U2-X1
+    R = S2-Y1
+
+    The line yp - l*xp*w + (l*x2 - y2)*w^3, with l = R*ZZ1/(P*ZZZ1), scaled by P*ZZZ1:
+        c0 = P*ZZZ1*yp
+        c3 = -R*ZZ1*xp
+        c4 = R*ZZ1*X2 - Y2*P*ZZZ1
+
+    PP = P^2
+    PPP = P*PP
+    Q = X1*PP
+    X3 = R^2-PPP-2*Q
+    Y3 = R*(Q-X3)-Y1*PPP
+    ZZ3 = ZZ1*PP
+    ZZZ3 = ZZZ1*PPP
+*/
+template <typename Engine>
+void BnPairing<Engine>::additionStep(G2Point &t, G2PointAffine &q, F12Element &f, G1PointAffine &p) {
+    F2Element P, R, PP, PPP, Q, tmp;
+    F2Element c0, c3, c4;
+
+    E.f2.mul(P, q.x, t.zz);
+    E.f2.sub(P, P, t.x);
+    E.f2.mul(R, q.y, t.zzz);
+    E.f2.sub(R, R, t.y);
+
+    E.f2.mul(tmp, P, t.zzz);
+    mulByF1(c0, tmp, p.y);
+    E.f2.mul(c4, q.y, tmp);
+    E.f2.mul(tmp, R, t.zz);
+    mulByF1(c3, tmp, p.x);
+    E.f2.neg(c3, c3);
+    E.f2.mul(tmp, tmp, q.x);
+    E.f2.sub(c4, tmp, c4);
+
+    E.f12.mulBy034(f, f, c0, c3, c4);
+
+    E.f2.square(PP, P);
+    E.f2.mul(PPP, P, PP);
+    E.f2.mul(Q, t.x, PP);
+
+    E.f2.square(t.x, R);
+    E.f2.sub(t.x, t.x, PPP);
+    E.f2.sub(t.x, t.x, Q);
+    E.f2.sub(t.x, t.x, Q);
+
+    E.f2.mul(tmp, t.y, PPP);
+    E.f2.sub(t.y, Q, t.x);
+    E.f2.mul(t.y, t.y, R);
+    E.f2.sub(t.y, t.y, tmp);
+
+    E.f2.mul(t.zz, t.zz, PP);
+    E.f2.mul(t.zzz, t.zzz, PPP);
+}
+
+/*
+    f = prod_i f_{6u+2,q[i]}(p[i]) * l_{[6u+2]q[i],pi(q[i])}(p[i]) * l_{[6u+2]q[i]+pi(q[i]),-pi^2(q[i])}(p[i])
+    The squarings of f are shared by all the pairs.
+*/
+template <typename Engine>
+void BnPairing<Engine>::millerLoopChunk(F12Element &r, G1PointAffine *p, G2PointAffine *q, uint64_t n) {
+    G2Point *t = new G2Point[n];
+    bool *skip = new bool[n];
+
+    for (uint64_t i=0; i<n; i++) {
+        skip[i] = E.g1.isZero(p[i]) || E.g2.isZero(q[i]);
+        E.g2.copy(t[i], q[i]);
+    }
+
+    E.f12.copy(r, E.f12.one());
+
+    for (int b=mpz_sizeinbase(ateLoopCount, 2)-2; b>=0; b--) {
+        E.f12.square(r, r);
+        for (uint64_t i=0; i<n; i++) {
+            if (skip[i]) continue;
+            doublingStep(t[i], r, p[i]);
+        }
+        if (mpz_tstbit(ateLoopCount, b)) {
+            for (uint64_t i=0; i<n; i++) {
+                if (skip[i]) continue;
+                additionStep(t[i], q[i], r, p[i]);
+            }
+        }
+    }
+
+    G2PointAffine q1, q2;
+    for (uint64_t i=0; i<n; i++) {
+        if (skip[i]) continue;
+        frobeniusG2(q1, q[i], 1);
+        frobeniusG2(q2, q[i], 2);
+        E.f2.neg(q2.y, q2.y);
+        additionStep(t[i], q1, r, p[i]);
+        additionStep(t[i], q2, r, p[i]);
+    }
+
+    delete[] skip;
+    delete[] t;
+}
+
+template <typename Engine>
+void BnPairing<Engine>::millerLoop(F12Element &r, G1PointAffine *p, G2PointAffine *q, uint64_t n, uint32_t nThreads) {
+    nThreads = nThreads==0 ? omp_get_max_threads() : nThreads;
+    if (nThreads > n) nThreads = n;
+    if (nThreads == 0) nThreads = 1;
+
+    F12Element *partials = new F12Element[nThreads];
+
+    #pragma omp parallel for num_threads(nThreads)
+    for (uint32_t i=0; i<nThreads; i++) {
+        uint64_t start = (n*i) / nThreads;
+        uint64_t end = (n*(i+1)) / nThreads;
+        millerLoopChunk(partials[i], p+start, q+start, end-start);
+    }
+
+    E.f12.copy(r, partials[0]);
+    for (uint32_t i=1; i<nThreads; i++) {
+        E.f12.mul(r, r, partials[i]);
+    }
+
+    delete[] partials;
+}
+
+// expByU is only used in the cyclotomic subgroup, where a^-1 is the conjugate, so the NAF of u
+// saves the products of the runs of ones.
+template <typename Engine>
+void BnPairing<Engine>::expByU(F12Element &r, F12Element &a) {
+    F12Element copyA, conjA;
+    E.f12.copy(copyA, a);
+    E.f12.conjugate(conjA, a);
+    E.f12.copy(r, copyA);
+    for (int i=uNaf.size()-2; i>=0; i--) {
+        E.f12.square(r, r);
+        if (uNaf[i] == 1) {
+            E.f12.mul(r, r, copyA);
+        } else if (uNaf[i] == -1) {
+            E.f12.mul(r, r, conjA);
+        }
+    }
+}
+
+/*
+    r = f^((q^12-1)/r)
+
+    Easy part: f^((q^6-1)*(q^2+1))
+    Hard part: addition chain on u for a multiple of (q^4-q^2+1)/r (libff / Scott et al.).
+    After the easy part f is in the cyclotomic subgroup, so inverses are conjugates.
+*/
+template <typename Engine>
+void BnPairing<Engine>::finalExponentiation(F12Element &r, F12Element &f) {
+    F12Element t0, t1;
+
+    E.f12.conjugate(t0, f);
+    E.f12.inv(t1, f);
+    E.f12.mul(t0, t0, t1);
+    frobenius(t1, t0, 2);
+    F12Element elt;
+    E.f12.mul(elt, t1, t0);
+
+    F12Element A, B, C, D, Ee, F, G, H, I, J, K, L, M, N, O, P, Q, R, S, T, U;
+
+    expByU(A, elt);
+    E.f12.conjugate(A, A);
+    E.f12.square(B, A);
+    E.f12.square(C, B);
+    E.f12.mul(D, C, B);
+    expByU(Ee, D);
+    E.f12.conjugate(Ee, Ee);
+    E.f12.square(F, Ee);
+    expByU(G, F);
+    E.f12.conjugate(G, G);
+    E.f12.conjugate(H, D);
+    E.f12.conjugate(I, G);
+    E.f12.mul(J, I, Ee);
+    E.f12.mul(K, J, H);
+    E.f12.mul(L, K, B);
+    E.f12.mul(M, K, Ee);
+    E.f12.mul(N, M, elt);
+    frobenius(O, L, 1);
+    E.f12.mul(P, O, N);
+    frobenius(Q, K, 2);
+    E.f12.mul(R, Q, P);
+    E.f12.conjugate(S, elt);
+    E.f12.mul(T, S, L);
+    frobenius(U, T, 3);
+    E.f12.mul(r, U, R);
+}
+
+template <typename Engine>
+void BnPairing<Engine>::pairing(F12Element &r, G1PointAffine &p, G2PointAffine &q) {
+    F12Element f;
+    millerLoop(f, p, q);
+    finalExponentiation(r, f);
+}
+
+template <typename Engine>
+bool BnPairing<Engine>::pairingCheck(G1PointAffine *p, G2PointAffine *q, uint64_t n, uint32_t nThreads) {
+    F12Element f, r;
+    millerLoop(f, p, q, n, nThreads);
+    finalExponentiation(r, f);
+    return E.f12.eq(r, E.f12.one());
+}
@@ -0,0 +1,67 @@
+#ifndef PAIRING_H
+#define PAIRING_H
+
+#include <gmp.h>
+#include <string>
+#include <vector>
+
+/*
+    Optimal ate pairing for BN curves with a D-type sextic twist:
+        G2 = E'(F2): y^2 = x^3 + b/nr6
+        F6 = F2[v]/(v^3 - nr6)
+        F12 = F6[w]/(w^2 - v)
+
+    Engine must provide the F1, F2, F6, F12, G1 and G2 types and the f1, f2, f6, f12 members.
+    u is the BN parameter of the curve.
+*/
+template <typename Engine>
+class BnPairing {
+
+    typedef typename Engine::F1Element F1Element;
+    typedef typename Engine::F2Element F2Element;
+    typedef typename Engine::F12Element F12Element;
+    typedef typename Engine::G1PointAffine G1PointAffine;
+    typedef typename Engine::G2Point G2Point;
+    typedef typename Engine::G2PointAffine G2PointAffine;
+
+    Engine &E;
+
+    mpz_t u;
+    mpz_t ateLoopCount;
+
+    // Non adjacent form of u, least significant digit first (-1, 0 or 1)
+    std::vector<int8_t> uNaf;
+
+    // frobeniusCoefs[k][j] = nr6^(j*(q^k-1)/6)
+    F2Element frobeniusCoefs[4][6];
+
+    void expF2(F2Element &r, F2Element &base, mpz_t e);
+    void mulByF1(F2Element &r, F2Element &a, F1Element &b);
+    void conjugateF2(F2Element &r, F2Element &a);
+    void expByU(F12Element &r, F12Element &a);
+
+    void frobeniusG2(G2PointAffine &r, G2PointAffine &a, int k);
+    void doublingStep(G2Point &t, F12Element &f, G1PointAffine &p);
+    void additionStep(G2Point &t, G2PointAffine &q, F12Element &f, G1PointAffine &p);
+    void millerLoopChunk(F12Element &r, G1PointAffine *p, G2PointAffine *q, uint64_t n);
+
+public:
+
+    BnPairing(Engine &_E, std::string us);
+    ~BnPairing();
+
+    void frobenius(F12Element &r, F12Element &a, int k);
+
+    void millerLoop(F12Element &r, G1PointAffine *p, G2PointAffine *q, uint64_t n, uint32_t nThreads = 0);
+    void millerLoop(F12Element &r, G1PointAffine &p, G2PointAffine &q) { millerLoop(r, &p, &q, 1, 1); };
+    void finalExponentiation(F12Element &r, F12Element &f);
+
+    void pairing(F12Element &r, G1PointAffine &p, G2PointAffine &q);
+
+    // Checks that e(p[0], q[0]) * ... * e(p[n-1], q[n-1]) == 1 with a single final exponentiation.
+    bool pairingCheck(G1PointAffine *p, G2PointAffine *q, uint64_t n, uint32_t nThreads = 0);
+};
+
+#include "pairing.cpp"
+
+#endif // PAIRING_H
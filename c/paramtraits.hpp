@@ -0,0 +1,25 @@
+#ifndef PARAM_TRAITS_H
+#define PARAM_TRAITS_H
+
+/*
+    Compile time description of the constants the curve and extension field formulas
+    branch on: a of y^2 = x^3 + a*x + b and the non residue of F2.
+    When the value is known the compiler folds the branches and drops the terms that vanish.
+    param_runtime keeps the value classification in the object and dispatches at run time.
+*/
+enum ParamType { param_zero, param_one, param_negone, param_long, param_runtime };
+
+template <ParamType typeOfA>
+struct CurveTraits {
+    static const ParamType A = typeOfA;
+};
+
+template <ParamType typeOfNr>
+struct F2FieldTraits {
+    static const ParamType Nr = typeOfNr;
+};
+
+typedef CurveTraits<param_runtime> RuntimeCurveTraits;
+typedef F2FieldTraits<param_runtime> RuntimeF2FieldTraits;
+
+#endif // PARAM_TRAITS_H
@@ -13,8 +13,11 @@ module.exports = class RegManager {
             "adox": ["IOR", "I"],
             "shl": ["IOR", "I"],
             "shr": ["IOR", "I"],
+            "add": ["IO", "I"],
+            "adc": ["IO", "I"],
             "sub": ["IO", "I"],
             "sbb": ["IO", "I"],
+            "and": ["IO", "I"],
             "cmp": ["I", "I"],
             "test": ["I", "I"],
             "mov": ["O", "I"],
@@ -180,6 +183,10 @@ module.exports = class RegManager {
         this.code.push(`    ${instructionName} ${params.join(",")}`);
     }
 
+    getBody() {
+        return this.code.join("\n");
+    }
+
     getCode() {
 
         this._addHeader();
@@ -8,6 +8,12 @@ const renderFile = util.promisify(require("ejs").renderFile);
 const runningAsScript = !module.parent;
 
 const montgomeryBuilder = require("./montgomerybuilder");
+const pointBuilder = require("./pointbuilder");
+const plainBuilder = require("./plainbuilder");
+const inlineBuilder = require("./inlinebuilder");
+const chainBuilder = require("./chainbuilder");
+const specialBuilder = require("./specialbuilder");
+const wideBuilder = require("./widebuilder");
 
 class ZqBuilder {
     constructor(q, name) {
@@ -24,6 +30,26 @@ class ZqBuilder {
             return label+"_"+self.lastTmp;
         };
         this.montgomeryBuilder = montgomeryBuilder;
+        this.canOptimizeConsensys = montgomeryBuilder.freeTopBit(this.q);
+        this.pointBuilder = pointBuilder;
+        this.pointKernels = pointBuilder.canBuildPointKernels(this.q);
+        this.inlineBuilder = inlineBuilder;
+        this.plainBuilder = plainBuilder;
+        this.chainBuilder = chainBuilder;
+        this.specialBuilder = specialBuilder;
+        this.specialForm = specialBuilder.specialForm(this.q);
+        this.wideBuilder = wideBuilder;
+
+        // Alternative rawMMul/rawMSquare of the ADX backend, fr.cpp times them in init
+        this.mulStrategies = [];
+        if (wideBuilder.canBuildBlocked(this.q)) this.mulStrategies.push("blocked");
+        if (wideBuilder.canBuildKaratsuba(this.q)) this.mulStrategies.push("karatsuba");
+
+        // Functions with an ADX and a plain version, in the order of the dispatch table
+        this.dispatched = ["rawMMul", "rawMSquare", "rawMMul1", "rawFromMontgomery", "rawMulWide", "rawMontReduce"];
+        if (this.pointKernels) this.dispatched.push("rawPointAddMixed", "rawPointAdd", "rawPointDblA0");
+        // The ones with a portable C++ version too (fr_portable.cpp.ejs)
+        this.portable = ["rawMMul", "rawMSquare", "rawMMul1", "rawFromMontgomery", "rawMulWide", "rawMontReduce"];
     }
 
     constantElement(v) {
@@ -0,0 +1,107 @@
+const bigInt=require("big-integer");
+
+// Fixed exponent exponentiations as straight-line C++.
+//
+// The exponent is known when the field is generated, so the sliding window
+// decomposition (the addition chain) is computed here and the function is only
+// the sequence of squarings and multiplications, with no bit tests at run time.
+// The window size is the one with the fewest multiplications for the exponent.
+
+module.exports.buildChain = buildChain;
+module.exports.buildExpFunction = buildExpFunction;
+
+function windowCost(nBits, w) {
+    // Odd powers table (one squaring and 2^(w-1)-1 products) and about one product per w+1 bits
+    return (1 << (w-1)) + Math.ceil(nBits / (w+1));
+}
+
+/*
+    Returns {w, ops} where ops is the list of steps after acc = a^first:
+        ["square", k]  acc = acc^(2^k)
+        ["mul", i]     acc = acc * a^(2i+1)
+*/
+function buildChain(e) {
+    e = bigInt(e);
+    if (e.leq(0)) throw new Error("The exponent must be positive");
+    const bits = e.toString(2);
+    const nBits = bits.length;
+
+    let w = 1;
+    for (let i=2; i<=6; i++) if (windowCost(nBits, i) < windowCost(nBits, w)) w = i;
+
+    // Longest window from position i with at most w bits that ends in a 1
+    function window(i) {
+        let j = Math.min(i + w, nBits);
+        while (bits[j-1] == "0") j--;
+        return {end: j, v: parseInt(bits.slice(i, j), 2)};
+    }
+
+    const ops = [];
+    const first = window(0);
+    let i = first.end;
+    while (i<nBits) {
+        if (bits[i] == "0") {
+            ops.push(["square", 1]);
+            i++;
+        } else {
+            const win = window(i);
+            ops.push(["square", win.end - i]);
+            ops.push(["mul", (win.v - 1) / 2]);
+            i = win.end;
+        }
+    }
+
+    // Join the consecutive squarings
+    const joined = [];
+    for (const op of ops) {
+        const last = joined[joined.length-1];
+        if (last && last[0] == "square" && op[0] == "square") {
+            last[1] += op[1];
+        } else {
+            joined.push(op.slice());
+        }
+    }
+
+    let tableSize = (first.v + 1) / 2;
+    for (const op of joined) if (op[0] == "mul") tableSize = Math.max(tableSize, op[1] + 1);
+
+    return {w: w, first: (first.v - 1) / 2, tableSize: tableSize, ops: joined};
+}
+
+// static void fnName(<name>RawElement r, const <name>RawElement a), r = a^e in Montgomery form
+function buildExpFunction(fnName, name, e) {
+    const chain = buildChain(e);
+    const code = [];
+    let nSquares = 0;
+    let nMuls = chain.tableSize - 1;
+    for (const op of chain.ops) {
+        if (op[0] == "square") nSquares += op[1]; else nMuls++;
+    }
+
+    code.push(`// r = a^0x${bigInt(e).toString(16)}`);
+    code.push(`// Window of ${chain.w} bits: ${nSquares + (chain.tableSize > 1 ? 1 : 0)} squarings and ${nMuls} multiplications`);
+    code.push(`static void ${fnName}(${name}RawElement r, const ${name}RawElement a) {`);
+    code.push(`    ${name}RawElement t[${chain.tableSize}];     // t[i] = a^(2i+1)`);
+    code.push(`    ${name}RawElement acc;`);
+    code.push(`    ${name}_rawCopy(t[0], a);`);
+    if (chain.tableSize > 1) {
+        code.push(`    ${name}_rawMSquare(acc, a);`);
+        code.push(`    for (int i=1; i<${chain.tableSize}; i++) ${name}_rawMMul(t[i], t[i-1], acc);`);
+    }
+    code.push(`    ${name}_rawCopy(acc, t[${chain.first}]);`);
+    for (const op of chain.ops) {
+        if (op[0] == "square") {
+            if (op[1] == 1) {
+                code.push(`    ${name}_rawMSquare(acc, acc);`);
+            } else {
+                code.push(`    for (int i=0; i<${op[1]}; i++) ${name}_rawMSquare(acc, acc);`);
+            }
+        } else {
+            code.push(`    ${name}_rawMMul(acc, acc, t[${op[1]}]);`);
+        }
+    }
+    code.push(`    ${name}_rawCopy(r, acc);`);
+    code.push("}");
+
+    return code.join("\n");
+}
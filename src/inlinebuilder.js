@@ -0,0 +1,92 @@
+const AsmBuilder = require("./asmbuilder");
+const montgomeryBuilder = require("./montgomerybuilder");
+const pointBuilder = require("./pointbuilder");
+
+// Field operations as GCC extended inline asm, for the USE_INLINE_RAW header
+// implementation.
+//
+// It is the same code as the assembly functions, converted to AT&T syntax:
+//   rdi <= pRawResult, rsi <= pRawA, rdx <= pRawB
+//   [q + x] and [ np ] are passed as the %[q] and %[np] memory operands.
+//
+// The multiplication is only possible when the body does not spill and leaves
+// rbp free, which is up to 5 words (4 if q uses the top bit). Otherwise null is
+// returned and the header uses the C++ implementation.
+
+module.exports.buildMulInline = buildMulInline;
+module.exports.buildSquareInline = buildSquareInline;
+module.exports.buildAddInline = buildAddInline;
+module.exports.buildSubInline = buildSubInline;
+
+const regs = ["rax", "rbx", "rcx", "rdx", "rdi", "rsi", "rsp", "rbp", "r8", "r9", "r10", "r11", "r12", "r13", "r14", "r15"];
+
+function convertOperand(op) {
+    op = op.trim();
+    if (regs.indexOf(op) >= 0) return `%%${op}`;
+    if (/^\[\s*np\s*\]$/.test(op)) return "%[np]";
+    let m = /^\[\s*q\s*(?:\+\s*(\d+))?\s*\]$/.exec(op);
+    if (m) return (m[1] && m[1] != "0") ? `${m[1]}+%[q]` : "%[q]";
+    m = /^\[\s*(\w+)\s*(?:\+\s*(\d+))?\s*\]$/.exec(op);
+    if (m) return `${(m[2] && m[2] != "0") ? m[2] : ""}(%%${m[1]})`;
+    if (/^\d+$/.test(op)) return `$${op}`;
+    return op;   // label
+}
+
+function toGcc(body) {
+    const lines = [];
+    const used = {};
+    for (let l of body.split("\n")) {
+        l = l.trim();
+        if ((l == "")||(l[0] == ";")) continue;
+        if (l[l.length-1] == ":") {
+            lines.push(l);
+            continue;
+        }
+        const sp = l.indexOf(" ");
+        const ops = l.slice(sp+1).split(",").map(convertOperand);
+        for (let o of ops) {
+            const r = /^%%(\w+)$/.exec(o);
+            if (r) used[r[1]] = true;
+        }
+        lines.push(`${l.slice(0, sp)} ${ops.reverse().join(", ")}`);
+    }
+    return {lines, used};
+}
+
+function buildInline(body, inputs) {
+    const {lines, used} = toGcc(body);
+
+    const clobbers = Object.keys(used).filter( (r) => inputs.indexOf(r)<0 ).map( (r) => `"${r}"` );
+
+    return {
+        code: lines.map( (l) => `        "${l}\\n\\t"` ).join("\n"),
+        clobbers: clobbers.join(", ")
+    };
+}
+
+function buildMontgomeryInline(q, bodyBuilder, inputs) {
+    const c = new AsmBuilder("", montgomeryBuilder.montgomeryRegs(q));
+    if ((c.neededRegs > c.nUsedRegs) || (c.pushedRegs.indexOf("rbp") >= 0 && c.pushedRegs.indexOf("rbx") >= 0)) return null;
+
+    // Labels are made unique for every expansion with %=
+    let body = bodyBuilder(".L%=_mm", q);
+    if (c.pushedRegs.indexOf("rbp") >= 0) body = body.replace(/\brbp\b/g, "rbx");
+
+    return buildInline(body, inputs);
+}
+
+function buildMulInline(q) {
+    return buildMontgomeryInline(q, montgomeryBuilder.buildMulBody, ["rdi", "rsi", "rdx"]);
+}
+
+function buildSquareInline(q) {
+    return buildMontgomeryInline(q, montgomeryBuilder.buildSquareBody, ["rdi", "rsi"]);
+}
+
+function buildAddInline(q) {
+    return buildInline(pointBuilder.buildAddBody(".L%=_add", q), ["rdi", "rsi", "rdx"]);
+}
+
+function buildSubInline(q) {
+    return buildInline(pointBuilder.buildSubBody(".L%=_sub", q), ["rdi", "rsi", "rdx"]);
+}
@@ -11,12 +11,33 @@ module.exports.buildMul = buildMul;
 module.exports.buildSquare = buildSquare;
 module.exports.buildMul1 = buildMul1;
 module.exports.buildFromMontgomery = buildFromMontgomery;
+module.exports.buildMulWide = buildMulWide;
+module.exports.buildMontReduce = buildMontReduce;
+module.exports.buildMulBody = buildMulBody;
+module.exports.buildSquareBody = buildSquareBody;
+module.exports.montgomeryRegs = montgomeryRegs;
+module.exports.freeTopBit = freeTopBit;
+
+// True if the top word of q leaves a free bit, so the CIOS window does not need an extra word
+// (canOptimizeConsensys).
+function freeTopBit(q) {
+    const n64 = Math.floor((q.bitLength() - 1) / 64)+1;
+    return q.shiftRight((n64-1)*64).leq( bigInt.one.shiftLeft(64).minus(1).shiftRight(1).minus(1) );
+}
+
+// Number of registers used by the Montgomery multiplication of this field.
+function montgomeryRegs(q) {
+    const n64 = Math.floor((q.bitLength() - 1) / 64)+1;
+    return 4 + n64 + 1 + (freeTopBit(q) ? 0 : 1);
+}
 
-function templateMontgomery(fn, q, upperLoop) {
+// reductionStep(c, params) adds m*q to the window and moves it one word down. It is the CIOS
+// second loop unless a special one is given (specialbuilder.js).
+function templateMontgomery(fn, q, upperLoop, beforeComparison, reductionStep) {
 
 
     const n64 = Math.floor((q.bitLength() - 1) / 64)+1;
-    const canOptimizeConsensys = q.shiftRight((n64-1)*64).leq( bigInt.one.shiftLeft(64).minus(1).shiftRight(1).minus(1) );
+    const canOptimizeConsensys = freeTopBit(q);
     const base = bigInt.one.shiftLeft(64);
     const np64 = base.minus(q.modInv(base));
     const t=4;
@@ -24,7 +45,7 @@ function templateMontgomery(fn, q, upperLoop) {
     const params = {q, n64, t, canOptimizeConsensys};
 
 
-    const c = new AsmBuilder(fn, 4 + n64 + 1 + (canOptimizeConsensys ? 0 : 1));
+    const c = new AsmBuilder(fn, montgomeryRegs(q));
 
     c.op("mov","rcx","rdx");   // rdx is needed for multiplications so keep it in cx
 
@@ -37,28 +58,13 @@ function templateMontgomery(fn, q, upperLoop) {
 
         upperLoop(c, params, i);
 
-        c.code.push("; SecondLoop");
-        c.op("mov", "rdx", 2);
-        c.op("mulx", 0, "rdx", t);
-        c.op("mulx", 1, 0, "[q]");
-        c.op("adcx", 0, t);
-        for (let j=1; j<n64; j++) {
-            c.op("mulx", (j+1)%2, t+j-1, `[q +${j*8}]`);
-            c.op("adcx", t+j-1, j%2);
-            c.op("adox", t+j-1, t+j);
-        }
-        c.op("mov", t+n64-1, 3);
-        c.op("adcx", t+n64-1, n64%2);
-        c.op("adox", t+n64-1, t+n64);
-        if (!canOptimizeConsensys) {
-            c.op("mov", t+n64, 3);
-            c.op("adcx", t+n64, 3);
-            c.op("adox", t+n64, t+n64+1);
-        }
+        (reductionStep || ciosReductionStep)(c, params);
 
         c.code.push("");
     }
 
+    if (beforeComparison) beforeComparison(c, params);
+
     c.code.push(";comparison");
     c.flushWr(false);
     if (!canOptimizeConsensys) {
@@ -85,50 +91,73 @@ function templateMontgomery(fn, q, upperLoop) {
         c.op("mov" ,  `[rdi + ${i*8}]`, t+i);
     }
 
-    return c.getCode();
+    return c;
 }
 
+function ciosReductionStep(c, params) {
+    const {t, n64, canOptimizeConsensys} = params;
+    c.code.push("; SecondLoop");
+    c.op("mov", "rdx", 2);
+    c.op("mulx", 0, "rdx", t);
+    c.op("mulx", 1, 0, "[q]");
+    c.op("adcx", 0, t);
+    for (let j=1; j<n64; j++) {
+        c.op("mulx", (j+1)%2, t+j-1, `[q +${j*8}]`);
+        c.op("adcx", t+j-1, j%2);
+        c.op("adox", t+j-1, t+j);
+    }
+    c.op("mov", t+n64-1, 3);
+    c.op("adcx", t+n64-1, n64%2);
+    c.op("adox", t+n64-1, t+n64);
+    if (!canOptimizeConsensys) {
+        c.op("mov", t+n64, 3);
+        c.op("adcx", t+n64, 3);
+        c.op("adox", t+n64, t+n64+1);
+    }
+}
 
-function buildMul(fn, q) {
-    return templateMontgomery(fn, q, function mulUpperLoop(c, params, i) {
-        const {t, n64, canOptimizeConsensys} = params;
-        c.code.push("; FirstLoop");
-        c.op("mov","rdx", `[rsi + ${i*8}]`);
-        if (i==0) {
-            c.op("mulx", 0, t, "[rcx]");
-            for (let j=1; j<n64; j++) {
-                c.op("mulx", j%2, t+j, `[rcx +${j*8}]`);
-                c.op("adcx", t+j, (j-1)%2);
-            }
-            if (!canOptimizeConsensys) {
-                c.op("mov", t+n64, 3);
-                c.op("adcx", t+n64 , (n64-1)%2);
-                c.op("mov", t+n64+1, 3);
-                c.op("adcx", t+n64+1, 3);
-            } else {
-                c.op("mov", t+n64, 3);
-                c.op("adcx", t+n64 , (n64-1)%2);
-            }
+function mulUpperLoop(c, params, i) {
+    const {t, n64, canOptimizeConsensys} = params;
+    c.code.push("; FirstLoop");
+    c.op("mov","rdx", `[rsi + ${i*8}]`);
+    if (i==0) {
+        c.op("mulx", 0, t, "[rcx]");
+        for (let j=1; j<n64; j++) {
+            c.op("mulx", j%2, t+j, `[rcx +${j*8}]`);
+            c.op("adcx", t+j, (j-1)%2);
+        }
+        if (!canOptimizeConsensys) {
+            c.op("mov", t+n64, 3);
+            c.op("adcx", t+n64 , (n64-1)%2);
+            c.op("mov", t+n64+1, 3);
+            c.op("adcx", t+n64+1, 3);
         } else {
-            if (!canOptimizeConsensys) {
-                c.op("mov", t+n64+1, 3);
-            } else {
-                c.op("mov", t+n64, 3);
-            }
-            for (let j=0; j<n64; j++) {
-                c.op("mulx", 1, 0, `[rcx +${j*8}]`);
-                c.op("adcx", t+j, 0);
-                c.op("adox", t+j+1, 1);
-            }
-            if (!canOptimizeConsensys) {
-                c.op("adcx", t+n64, 3);
-                c.op("adcx", t+n64+1, 3);
-                c.op("adox", t+n64+1, 3);
-            } else {
-                c.op("adcx", t+n64, 3);
-            }
+            c.op("mov", t+n64, 3);
+            c.op("adcx", t+n64 , (n64-1)%2);
         }
-    });
+    } else {
+        if (!canOptimizeConsensys) {
+            c.op("mov", t+n64+1, 3);
+        } else {
+            c.op("mov", t+n64, 3);
+        }
+        for (let j=0; j<n64; j++) {
+            c.op("mulx", 1, 0, `[rcx +${j*8}]`);
+            c.op("adcx", t+j, 0);
+            c.op("adox", t+j+1, 1);
+        }
+        if (!canOptimizeConsensys) {
+            c.op("adcx", t+n64, 3);
+            c.op("adcx", t+n64+1, 3);
+            c.op("adox", t+n64+1, 3);
+        } else {
+            c.op("adcx", t+n64, 3);
+        }
+    }
+}
+
+function buildMul(fn, q, reductionStep) {
+    return templateMontgomery(fn, q, mulUpperLoop, null, reductionStep).getCode();
 }
 
 /*
@@ -216,13 +245,68 @@ function buildSquare(fn, q) {
 */
 
 
-function buildSquare(fn, q) {
+function squareUpperLoop(c, params, i) {
+    const {t, n64, canOptimizeConsensys} = params;
+    c.code.push("; FirstLoop");
+    c.op("mov","rdx", `[rsi + ${i*8}]`);
+    if (i==0) {
+        c.op("mulx", 0, t, "rdx");
+        for (let j=1; j<n64; j++) {
+            c.op("mulx", j%2, t+j, `[rsi +${j*8}]`);
+            c.op("adcx", t+j, (j-1)%2);
+        }
+        if (!canOptimizeConsensys) {
+            c.op("mov", t+n64, 3);
+            c.op("adcx", t+n64 , (n64-1)%2);
+            c.op("mov", t+n64+1, 3);
+            c.op("adcx", t+n64+1, 3);
+        } else {
+            c.op("mov", t+n64, 3);
+            c.op("adcx", t+n64 , (n64-1)%2);
+        }
+    } else {
+        if (!canOptimizeConsensys) {
+            c.op("mov", t+n64+1, 3);
+        } else {
+            c.op("mov", t+n64, 3);
+        }
+        for (let j=0; j<n64; j++) {
+            c.op("mulx", 1, 0, `[rsi +${j*8}]`);
+            c.op("adcx", t+j, 0);
+            c.op("adox", t+j+1, 1);
+        }
+        if (!canOptimizeConsensys) {
+            c.op("adcx", t+n64, 3);
+            c.op("adcx", t+n64+1, 3);
+            c.op("adox", t+n64+1, 3);
+        } else {
+            c.op("adcx", t+n64, 3);
+        }
+    }
+}
+
+function buildSquare(fn, q, reductionStep) {
+    return templateMontgomery(fn, q, squareUpperLoop, null, reductionStep).getCode();
+}
+
+// Same code as buildMul/buildSquare, without prologue and ret, to be inlined in a routine
+// that already saved the registers. label must be unique in the routine.
+function buildMulBody(label, q) {
+    return templateMontgomery(label, q, mulUpperLoop).getBody();
+}
+
+function buildSquareBody(label, q) {
+    return templateMontgomery(label, q, squareUpperLoop).getBody();
+}
+
+
+function buildMul1(fn, q, reductionStep) {
     return templateMontgomery(fn, q, function mulUpperLoop(c, params, i) {
         const {t, n64, canOptimizeConsensys} = params;
-        c.code.push("; FirstLoop");
-        c.op("mov","rdx", `[rsi + ${i*8}]`);
         if (i==0) {
-            c.op("mulx", 0, t, "rdx");
+            c.code.push("; FirstLoop");
+            c.op("mov","rdx", "rcx");
+            c.op("mulx", 0, t, "[rsi]");
             for (let j=1; j<n64; j++) {
                 c.op("mulx", j%2, t+j, `[rsi +${j*8}]`);
                 c.op("adcx", t+j, (j-1)%2);
@@ -242,42 +326,21 @@ function buildSquare(fn, q) {
             } else {
                 c.op("mov", t+n64, 3);
             }
-            for (let j=0; j<n64; j++) {
-                c.op("mulx", 1, 0, `[rsi +${j*8}]`);
-                c.op("adcx", t+j, 0);
-                c.op("adox", t+j+1, 1);
-            }
-            if (!canOptimizeConsensys) {
-                c.op("adcx", t+n64, 3);
-                c.op("adcx", t+n64+1, 3);
-                c.op("adox", t+n64+1, 3);
-            } else {
-                c.op("adcx", t+n64, 3);
-            }
         }
-    });
+    }, null, reductionStep).getCode();
 }
 
-
-function buildMul1(fn, q) {
+function buildFromMontgomery(fn, q, reductionStep) {
     return templateMontgomery(fn, q, function mulUpperLoop(c, params, i) {
         const {t, n64, canOptimizeConsensys} = params;
         if (i==0) {
             c.code.push("; FirstLoop");
-            c.op("mov","rdx", "rcx");
-            c.op("mulx", 0, t, "[rsi]");
-            for (let j=1; j<n64; j++) {
-                c.op("mulx", j%2, t+j, `[rsi +${j*8}]`);
-                c.op("adcx", t+j, (j-1)%2);
+            for (let j=0; j<n64; j++) {
+                c.op("mov", t+j, `[rsi +${j*8}]`);
             }
+            c.op("mov", t+n64, 3);
             if (!canOptimizeConsensys) {
-                c.op("mov", t+n64, 3);
-                c.op("adcx", t+n64 , (n64-1)%2);
                 c.op("mov", t+n64+1, 3);
-                c.op("adcx", t+n64+1, 3);
-            } else {
-                c.op("mov", t+n64, 3);
-                c.op("adcx", t+n64 , (n64-1)%2);
             }
         } else {
             if (!canOptimizeConsensys) {
@@ -286,10 +349,13 @@ function buildMul1(fn, q) {
                 c.op("mov", t+n64, 3);
             }
         }
-    });
+    }, null, reductionStep).getCode();
 }
 
-function buildFromMontgomery(fn, q) {
+// Montgomery reduction of a double width value T < q*2^(64*n64).
+// The lower half is reduced with the fromMontgomery loop and the upper half is
+// added afterwards: (lo + m*q)/R + hi = T/R (mod q), and it is < 2q.
+function buildMontReduce(fn, q, reductionStep) {
     return templateMontgomery(fn, q, function mulUpperLoop(c, params, i) {
         const {t, n64, canOptimizeConsensys} = params;
         if (i==0) {
@@ -308,7 +374,59 @@ function buildFromMontgomery(fn, q) {
                 c.op("mov", t+n64, 3);
             }
         }
-    });
+    }, function addUpperHalf(c, params) {
+        const {t, n64, canOptimizeConsensys} = params;
+        c.code.push("; Add upper half");
+        c.op("xor", 3, 3);
+        for (let j=0; j<n64; j++) {
+            c.op("adcx", t+j, `[rsi +${(n64+j)*8}]`);
+        }
+        if (!canOptimizeConsensys) {
+            c.op("adcx", t+n64, 3);
+        }
+    }, reductionStep).getCode();
+}
+
+// Plain (not reduced) product of two elements. The result has 2*n64 words.
+// The accumulator window rotates over n64+1 registers, so word k lives in R(k).
+// rdi must not overlap rsi or rdx.
+function buildMulWide(fn, q) {
+    const n64 = Math.floor((q.bitLength() - 1) / 64)+1;
+    const t=4;
+    const R = (k) => t + (k % (n64+1));
+
+    const c = new AsmBuilder(fn, 4 + n64 + 1);
+
+    c.op("mov","rcx","rdx");   // rdx is needed for multiplications so keep it in cx
+    c.op("xor", 3, 3);
+
+    for (let i=0; i<n64; i++) {
+        c.code.push("; Row " + i);
+        c.op("mov","rdx", `[rsi + ${i*8}]`);
+        if (i==0) {
+            c.op("mulx", 0, R(0), "[rcx]");
+            for (let j=1; j<n64; j++) {
+                c.op("mulx", j%2, R(j), `[rcx +${j*8}]`);
+                c.op("adcx", R(j), (j-1)%2);
+            }
+            c.op("mov", R(n64), 3);
+            c.op("adcx", R(n64), (n64-1)%2);
+        } else {
+            c.op("mov", R(i+n64), 3);
+            for (let j=0; j<n64; j++) {
+                c.op("mulx", 1, 0, `[rcx +${j*8}]`);
+                c.op("adcx", R(i+j), 0);
+                c.op("adox", R(i+j+1), 1);
+            }
+            c.op("adcx", R(i+n64), 3);
+        }
+        c.op("mov", `[rdi + ${i*8}]`, R(i));
+    }
+    for (let i=n64; i<2*n64; i++) {
+        c.op("mov", `[rdi + ${i*8}]`, R(i));
+    }
+
+    return c.getCode();
 }
 
 
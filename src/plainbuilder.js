@@ -0,0 +1,219 @@
+// Montgomery functions with only mul/adc/imul (no BMI2/ADX), for the hosts that do not have them.
+//
+// Same interface and results as montgomerybuilder.js. CIOS with the accumulator t[0..n64]
+// in r11..rbp when it fits and in the stack frame when it does not:
+//   r8 <= carry of the inner loops
+//   r9 <= b[i] and then m
+//   r10 <= carry out of t[n64]
+
+module.exports.plainRegs = plainRegs;
+module.exports.buildMulPlain = buildMulPlain;
+module.exports.buildSquarePlain = buildSquarePlain;
+module.exports.buildMul1Plain = buildMul1Plain;
+module.exports.buildFromMontgomeryPlain = buildFromMontgomeryPlain;
+module.exports.buildMulWidePlain = buildMulWidePlain;
+module.exports.buildMontReducePlain = buildMontReducePlain;
+module.exports.buildMulBodyPlain = buildMulBodyPlain;
+module.exports.buildSquareBodyPlain = buildSquareBodyPlain;
+
+const tRegs = ["r11", "r12", "r13", "r14", "r15", "rbx", "rbp"];
+const calleeSaved = ["r12", "r13", "r14", "r15", "rbx", "rbp"];
+
+function plainRegs(q) {
+    const n64 = Math.floor((q.bitLength() - 1) / 64)+1;
+    const onRegs = n64+1 <= tRegs.length;
+    const t = [];
+    for (let i=0; i<=n64; i++) t.push(onRegs ? tRegs[i] : `qword [rsp + ${i*8}]`);
+    return {
+        n64: n64,
+        t: t,
+        pushedRegs: onRegs ? calleeSaved.filter( (r) => tRegs.indexOf(r) <= n64 ) : [],
+        frameSize: onRegs ? 0 : (n64+1)*8
+    };
+}
+
+// t[0..n64-1] (+ top*2^(64*n64)) < 2q  =>  [rdi] = t mod q
+function finalSubtract(code, label, n64, t, top) {
+    for (let j=0; j<n64; j++) {
+        code.push(`    mov rax, ${t[j]}`);
+        code.push(`    ${j==0 ? "sub" : "sbb"} rax, [q + ${j*8}]`);
+        code.push(`    mov [rdi + ${j*8}], rax`);
+    }
+    code.push(`    mov rax, ${top}`);
+    code.push("    sbb rax, 0");
+    code.push(`    jnc ${label}_done`);
+    for (let j=0; j<n64; j++) {
+        code.push(`    mov rax, ${t[j]}`);
+        code.push(`    mov [rdi + ${j*8}], rax`);
+    }
+    code.push(`${label}_done:`);
+}
+
+// One reduction step of CIOS: t = (t + m*q) >> 64 with m = t[0]*np
+function reductionStep(code, n64, t) {
+    code.push(`    mov r9, ${t[0]}`);
+    code.push("    imul r9, [np]");
+    code.push("    mov rax, [q]");
+    code.push("    mul r9");
+    code.push(`    add rax, ${t[0]}`);
+    code.push("    adc rdx, 0");
+    code.push("    mov r8, rdx");
+    for (let j=1; j<n64; j++) {
+        code.push(`    mov rax, [q + ${j*8}]`);
+        code.push("    mul r9");
+        code.push(`    add rax, ${t[j]}`);
+        code.push("    adc rdx, 0");
+        code.push("    add rax, r8");
+        code.push("    adc rdx, 0");
+        code.push(`    mov ${t[j-1]}, rax`);
+        code.push("    mov r8, rdx");
+    }
+    code.push(`    mov rax, ${t[n64]}`);
+    code.push("    add rax, r8");
+    code.push(`    mov ${t[n64-1]}, rax`);
+    code.push("    adc r10, 0");
+    code.push(`    mov ${t[n64]}, r10`);
+}
+
+/*
+    [rdi] = [rsi] * b / R mod q
+    b is [bPtr] or, when bPtr is null, the single word in r9.
+*/
+function buildBody(label, q, bPtr) {
+    const {n64, t} = plainRegs(q);
+    const code = [];
+
+    for (let i=0; i<=n64; i++) code.push(`    mov ${t[i]}, 0`);
+    for (let i=0; i<n64; i++) {
+        if ((bPtr !== null)||(i==0)) {
+            if (bPtr !== null) code.push(`    mov r9, [${bPtr} + ${i*8}]`);
+            code.push("    xor r8, r8");
+            for (let j=0; j<n64; j++) {
+                code.push(`    mov rax, [rsi + ${j*8}]`);
+                code.push("    mul r9");
+                code.push(`    add rax, ${t[j]}`);
+                code.push("    adc rdx, 0");
+                code.push("    add rax, r8");
+                code.push("    adc rdx, 0");
+                code.push(`    mov ${t[j]}, rax`);
+                code.push("    mov r8, rdx");
+            }
+            code.push(`    add ${t[n64]}, r8`);
+            code.push("    mov r10, 0");
+            code.push("    adc r10, 0");
+        } else {
+            code.push("    xor r10, r10");
+        }
+        reductionStep(code, n64, t);
+    }
+    finalSubtract(code, label, n64, t, t[n64]);
+
+    return code.join("\n");
+}
+
+function buildMulBodyPlain(label, q) {
+    return "    mov rcx, rdx\n" + buildBody(label, q, "rcx");
+}
+
+function buildSquareBodyPlain(label, q) {
+    return buildBody(label, q, "rsi");
+}
+
+function buildFunction(fn, q, body) {
+    const {pushedRegs, frameSize} = plainRegs(q);
+    const code = [];
+    code.push(`${fn}:`);
+    for (let i=0; i<pushedRegs.length; i++) code.push(`    push ${pushedRegs[i]}`);
+    if (frameSize) code.push(`    sub rsp, ${frameSize}`);
+    code.push(body);
+    if (frameSize) code.push(`    add rsp, ${frameSize}`);
+    for (let i=pushedRegs.length-1; i>=0; i--) code.push(`    pop ${pushedRegs[i]}`);
+    code.push("    ret");
+    return code.join("\n");
+}
+
+function buildMulPlain(fn, q) {
+    return buildFunction(fn, q, buildMulBodyPlain(fn, q));
+}
+
+function buildSquarePlain(fn, q) {
+    return buildFunction(fn, q, buildSquareBodyPlain(fn, q));
+}
+
+function buildMul1Plain(fn, q) {
+    return buildFunction(fn, q, "    mov r9, rdx\n" + buildBody(fn, q, null));
+}
+
+function buildFromMontgomeryPlain(fn, q) {
+    return buildFunction(fn, q, "    mov r9, 1\n" + buildBody(fn, q, null));
+}
+
+// [rdi] (2*n64 words) = [rsi] * [rdx]
+function buildMulWidePlain(fn, q) {
+    const n64 = Math.floor((q.bitLength() - 1) / 64)+1;
+    const code = [];
+    code.push(`${fn}:`);
+    code.push("    mov rcx, rdx");
+    for (let k=0; k<2*n64; k++) code.push(`    mov qword [rdi + ${k*8}], 0`);
+    for (let i=0; i<n64; i++) {
+        code.push(`    mov r9, [rcx + ${i*8}]`);
+        code.push("    xor r8, r8");
+        for (let j=0; j<n64; j++) {
+            code.push(`    mov rax, [rsi + ${j*8}]`);
+            code.push("    mul r9");
+            code.push(`    add rax, [rdi + ${(i+j)*8}]`);
+            code.push("    adc rdx, 0");
+            code.push("    add rax, r8");
+            code.push("    adc rdx, 0");
+            code.push(`    mov [rdi + ${(i+j)*8}], rax`);
+            code.push("    mov r8, rdx");
+        }
+        code.push(`    mov [rdi + ${(i+n64)*8}], r8`);
+    }
+    code.push("    ret");
+    return code.join("\n");
+}
+
+/*
+    [rdi] = [rsi] / R mod q, with [rsi] 2*n64 words < q*R
+    The window t[0..n64-1] moves up one word per step, r10 is the carry into the next word.
+*/
+function buildMontReducePlain(fn, q) {
+    const {n64, t} = plainRegs(q);
+    const code = [];
+
+    for (let i=0; i<n64; i++) {
+        code.push(`    mov rax, [rsi + ${i*8}]`);
+        code.push(`    mov ${t[i]}, rax`);
+    }
+    code.push("    xor r10, r10");
+    for (let i=0; i<n64; i++) {
+        code.push(`    mov r9, ${t[0]}`);
+        code.push("    imul r9, [np]");
+        code.push("    mov rax, [q]");
+        code.push("    mul r9");
+        code.push(`    add rax, ${t[0]}`);
+        code.push("    adc rdx, 0");
+        code.push("    mov r8, rdx");
+        for (let j=1; j<n64; j++) {
+            code.push(`    mov rax, [q + ${j*8}]`);
+            code.push("    mul r9");
+            code.push(`    add rax, ${t[j]}`);
+            code.push("    adc rdx, 0");
+            code.push("    add rax, r8");
+            code.push("    adc rdx, 0");
+            code.push(`    mov ${t[j-1]}, rax`);
+            code.push("    mov r8, rdx");
+        }
+        code.push(`    mov rax, [rsi + ${(n64+i)*8}]`);
+        code.push("    add rax, r10");
+        code.push("    mov r10, 0");
+        code.push("    adc r10, 0");
+        code.push("    add rax, r8");
+        code.push("    adc r10, 0");
+        code.push(`    mov ${t[n64-1]}, rax`);
+    }
+    finalSubtract(code, fn, n64, t, "r10");
+
+    return buildFunction(fn, q, code.join("\n"));
+}
@@ -0,0 +1,292 @@
+const AsmBuilder = require("./asmbuilder");
+const montgomeryBuilder = require("./montgomerybuilder");
+const plainBuilder = require("./plainbuilder");
+
+// Fused XYZZ point operations.
+//
+// Each point operation is emitted as a single routine: the field multiplications are the
+// inlined Montgomery bodies of montgomerybuilder.js, the registers are saved once and all
+// the intermediate values live in one stack frame.
+//
+// Params:
+//   rdi <= Pointer to the result point (x, y, zz, zzz)
+//   rsi <= Pointer to point 1 (x, y, zz, zzz)
+//   rdx <= Pointer to point 2 (x, y, zz, zzz), or (x, y) for the mixed addition
+// Returns:
+//   rax <= 1 if the two points are equal and the result was not written (the caller must double), 0 otherwise.
+//
+// The result can be the same as any of the inputs.
+// Zero points are not handled, the caller must check them before.
+//
+// With plain set, the multiplications are the plainbuilder.js ones (no BMI2/ADX).
+
+module.exports.canBuildPointKernels = canBuildPointKernels;
+module.exports.buildPointAddMixed = buildPointAddMixed;
+module.exports.buildPointAdd = buildPointAdd;
+module.exports.buildPointDblA0 = buildPointDblA0;
+module.exports.buildAddBody = buildAddBody;
+module.exports.buildSubBody = buildSubBody;
+
+const coordinates = ["x", "y", "zz", "zzz"];
+const pointRegs = { r: "rdi", p1: "rsi", p2: "rdx" };
+
+// The inlined multiplications address the stack frame through rsp, so they must not spill.
+// The plain ones fit in the registers up to 6 words, so checking the ADX ones is enough.
+function canBuildPointKernels(q) {
+    const c = new AsmBuilder("", montgomeryBuilder.montgomeryRegs(q));
+    return c.neededRegs <= c.nUsedRegs;
+}
+
+// [rdi] = [rsi] + [rdx] mod q. Only rax is used.
+function buildAddBody(label, q) {
+    const n64 = Math.floor((q.bitLength() - 1) / 64)+1;
+    const code = [];
+    for (let i=0; i<n64; i++) {
+        code.push(`    mov rax, [rsi + ${i*8}]`);
+        code.push(`    ${i==0 ? "add" : "adc"} rax, [rdx + ${i*8}]`);
+        code.push(`    mov [rdi + ${i*8}], rax`);
+    }
+    code.push(`    jc ${label}_sq`);
+    for (let i=n64-1; i>=0; i--) {
+        code.push(`    mov rax, [rdi + ${i*8}]`);
+        code.push(`    cmp rax, [q + ${i*8}]`);
+        code.push(`    jc ${label}_done`);
+        code.push(`    jnz ${label}_sq`);
+    }
+    code.push(`${label}_sq:`);
+    for (let i=0; i<n64; i++) {
+        code.push(`    mov rax, [q + ${i*8}]`);
+        code.push(`    ${i==0 ? "sub" : "sbb"} [rdi + ${i*8}], rax`);
+    }
+    code.push(`${label}_done:`);
+    return code.join("\n");
+}
+
+// [rdi] = [rsi] - [rdx] mod q. Only rax is used.
+function buildSubBody(label, q) {
+    const n64 = Math.floor((q.bitLength() - 1) / 64)+1;
+    const code = [];
+    for (let i=0; i<n64; i++) {
+        code.push(`    mov rax, [rsi + ${i*8}]`);
+        code.push(`    ${i==0 ? "sub" : "sbb"} rax, [rdx + ${i*8}]`);
+        code.push(`    mov [rdi + ${i*8}], rax`);
+    }
+    code.push(`    jnc ${label}_done`);
+    for (let i=0; i<n64; i++) {
+        code.push(`    mov rax, [q + ${i*8}]`);
+        code.push(`    ${i==0 ? "add" : "adc"} [rdi + ${i*8}], rax`);
+    }
+    code.push(`${label}_done:`);
+    return code.join("\n");
+}
+
+class PointBuilder {
+    constructor(fn, q, plain) {
+        this.fn = fn;
+        this.q = q;
+        this.plain = plain;
+        this.n64 = Math.floor((q.bitLength() - 1) / 64)+1;
+        this.code = [];
+        this.tmps = {};
+        this.nTmps = 0;
+        this.nLabels = 0;
+    }
+
+    label(name) {
+        this.nLabels ++;
+        return `${this.fn}_${name}_${this.nLabels}`;
+    }
+
+    // Loads in reg the address of an operand: "p1.x", "r.zz" or the name of a temporary
+    loadAddr(reg, operand) {
+        const parts = operand.split(".");
+        if (parts.length == 2) {
+            const ptrIdx = Object.keys(pointRegs).indexOf(parts[0]);
+            const offset = coordinates.indexOf(parts[1])*this.n64*8;
+            this.code.push(`    mov ${reg}, [rsp + ${ptrIdx*8}]`);
+            if (offset) this.code.push(`    add ${reg}, ${offset}`);
+        } else {
+            if (typeof this.tmps[operand] === "undefined") {
+                this.tmps[operand] = this.nTmps++;
+            }
+            this.code.push(`    lea ${reg}, [rsp + ${24 + this.tmps[operand]*this.n64*8}]`);
+        }
+    }
+
+    loadOperands(r, a, b) {
+        this.loadAddr("rdi", r);
+        this.loadAddr("rsi", a);
+        if (b) this.loadAddr("rdx", b);
+    }
+
+    mul(r, a, b) {
+        this.code.push(`    ; ${r} = ${a}*${b}`);
+        this.loadOperands(r, a, b);
+        const body = this.plain ? plainBuilder.buildMulBodyPlain : montgomeryBuilder.buildMulBody;
+        this.code.push(body(this.label("mul"), this.q));
+    }
+
+    square(r, a) {
+        this.code.push(`    ; ${r} = ${a}^2`);
+        this.loadOperands(r, a);
+        const body = this.plain ? plainBuilder.buildSquareBodyPlain : montgomeryBuilder.buildSquareBody;
+        this.code.push(body(this.label("square"), this.q));
+    }
+
+    add(r, a, b) {
+        this.code.push(`    ; ${r} = ${a}+${b}`);
+        this.loadOperands(r, a, b);
+        this.code.push(buildAddBody(this.label("add"), this.q));
+    }
+
+    sub(r, a, b) {
+        this.code.push(`    ; ${r} = ${a}-${b}`);
+        this.loadOperands(r, a, b);
+        this.code.push(buildSubBody(this.label("sub"), this.q));
+    }
+
+    // Returns 1 if a and b are both zero
+    returnIfBothZero(a, b) {
+        const lContinue = this.label("continue");
+        this.code.push(`    ; if (${a}==0 && ${b}==0) return 1`);
+        this.loadAddr("rsi", a);
+        this.loadAddr("rdx", b);
+        this.code.push("    mov rax, [rsi]");
+        for (let i=1; i<this.n64; i++) this.code.push(`    or rax, [rsi + ${i*8}]`);
+        for (let i=0; i<this.n64; i++) this.code.push(`    or rax, [rdx + ${i*8}]`);
+        this.code.push(`    jnz ${lContinue}`);
+        this.code.push("    mov rax, 1");
+        this.code.push(`    jmp ${this.fn}_exit`);
+        this.code.push(`${lContinue}:`);
+    }
+
+    getCode() {
+        const pushedRegs = this.plain ?
+            plainBuilder.plainRegs(this.q).pushedRegs :
+            new AsmBuilder("", montgomeryBuilder.montgomeryRegs(this.q)).pushedRegs;
+        const frameSize = 24 + this.nTmps*this.n64*8;
+
+        const code = [];
+        code.push(`${this.fn}:`);
+        for (let i=0; i<pushedRegs.length; i++) code.push(`    push ${pushedRegs[i]}`);
+        code.push(`    sub rsp, ${frameSize}`);
+        code.push("    mov [rsp], rdi");
+        code.push("    mov [rsp + 8], rsi");
+        code.push("    mov [rsp + 16], rdx");
+        code.push(...this.code);
+        code.push("    xor rax, rax");
+        code.push(`${this.fn}_exit:`);
+        code.push(`    add rsp, ${frameSize}`);
+        for (let i=pushedRegs.length-1; i>=0; i--) code.push(`    pop ${pushedRegs[i]}`);
+        code.push("    ret");
+
+        return code.join("\n");
+    }
+}
+
+/*
+    https://www.hyperelliptic.org/EFD/g1p/auto-shortw-xyzz.html#addition-madd-2008-s
+    The results are written in the same order as Curve::add, so r can alias p1 or p2.
+*/
+function buildPointAddMixed(fn, q, plain) {
+    const c = new PointBuilder(fn, q, plain);
+
+    c.mul("U2", "p2.x", "p1.zz");
+    c.mul("S2", "p2.y", "p1.zzz");
+    c.sub("P", "U2", "p1.x");
+    c.sub("R", "S2", "p1.y");
+    c.returnIfBothZero("P", "R");
+    c.square("PP", "P");
+    c.mul("PPP", "P", "PP");
+    c.mul("Q", "p1.x", "PP");
+    c.mul("T", "p1.y", "PPP");
+
+    // X3 = R^2-PPP-2*Q
+    c.square("r.x", "R");
+    c.sub("r.x", "r.x", "PPP");
+    c.sub("r.x", "r.x", "Q");
+    c.sub("r.x", "r.x", "Q");
+
+    // Y3 = R*(Q-X3)-Y1*PPP
+    c.sub("r.y", "Q", "r.x");
+    c.mul("r.y", "r.y", "R");
+    c.sub("r.y", "r.y", "T");
+
+    c.mul("r.zz", "p1.zz", "PP");
+    c.mul("r.zzz", "p1.zzz", "PPP");
+
+    return c.getCode();
+}
+
+/*
+    https://www.hyperelliptic.org/EFD/g1p/auto-shortw-xyzz.html#addition-add-2008-s
+*/
+function buildPointAdd(fn, q, plain) {
+    const c = new PointBuilder(fn, q, plain);
+
+    c.mul("U1", "p1.x", "p2.zz");
+    c.mul("U2", "p2.x", "p1.zz");
+    c.mul("S1", "p1.y", "p2.zzz");
+    c.mul("S2", "p2.y", "p1.zzz");
+    c.sub("P", "U2", "U1");
+    c.sub("R", "S2", "S1");
+    c.returnIfBothZero("P", "R");
+    c.square("PP", "P");
+    c.mul("PPP", "P", "PP");
+    c.mul("Q", "U1", "PP");
+    c.mul("T", "S1", "PPP");
+
+    // X3 = R^2-PPP-2*Q
+    c.square("r.x", "R");
+    c.sub("r.x", "r.x", "PPP");
+    c.sub("r.x", "r.x", "Q");
+    c.sub("r.x", "r.x", "Q");
+
+    // Y3 = R*(Q-X3)-S1*PPP
+    c.sub("r.y", "Q", "r.x");
+    c.mul("r.y", "r.y", "R");
+    c.sub("r.y", "r.y", "T");
+
+    // ZZ3 = ZZ1*ZZ2*PP
+    c.mul("ZZ", "p1.zz", "p2.zz");
+    c.mul("r.zz", "ZZ", "PP");
+
+    // ZZZ3 = ZZZ1*ZZZ2*PPP
+    c.mul("ZZZ", "p1.zzz", "p2.zzz");
+    c.mul("r.zzz", "ZZZ", "PPP");
+
+    return c.getCode();
+}
+
+/*
+    https://www.hyperelliptic.org/EFD/g1p/auto-shortw-xyzz.html#doubling-dbl-2008-s-1
+    Only for curves with a = 0: M = 3*X1^2
+    rdx is not used. It always returns 0.
+*/
+function buildPointDblA0(fn, q, plain) {
+    const c = new PointBuilder(fn, q, plain);
+
+    c.add("U", "p1.y", "p1.y");
+    c.square("V", "U");
+    c.mul("W", "U", "V");
+    c.mul("S", "p1.x", "V");
+    c.square("XX", "p1.x");
+    c.add("M", "XX", "XX");
+    c.add("M", "M", "XX");
+    c.mul("T", "W", "p1.y");
+
+    // X3 = M^2-2*S
+    c.square("r.x", "M");
+    c.sub("r.x", "r.x", "S");
+    c.sub("r.x", "r.x", "S");
+
+    // Y3 = M*(S-X3)-W*Y1
+    c.sub("r.y", "S", "r.x");
+    c.mul("r.y", "r.y", "M");
+    c.sub("r.y", "r.y", "T");
+
+    c.mul("r.zz", "V", "p1.zz");
+    c.mul("r.zzz", "W", "p1.zzz");
+
+    return c.getCode();
+}
@@ -0,0 +1,84 @@
+const bigInt=require("big-integer");
+
+// Montgomery reduction for the primes q = 2^(64*n64) - c with c < 2^64.
+//
+// The representation and the results are the same as the generic Montgomery functions, only
+// the reduction step of templateMontgomery (montgomerybuilder.js) changes. The low word of q is
+// -c, so np = c^-1 mod 2^64 and m*q = m*2^(64*n64) - m*c: instead of the n64 products by q,
+// m*c is subtracted from the two lowest words and m is added to the top one.
+//
+//   pseudoMersenne   c is a dense word, m*c is one mulx (secp256k1, c = 2^32+977)
+//   solinas          c = 2^a +- 1 and m*c is two shifts (Goldilocks, c = 2^32-1)
+//
+// Only primes that use the top bit are taken, so the window always has the extra word t[n64+1]
+// (with a free top bit montgomeryRegs leaves it out).
+
+module.exports.specialForm = specialForm;
+module.exports.buildReductionStep = buildReductionStep;
+
+// Non adjacent form, [[sign, exponent], ...] from the lowest exponent
+function naf(v) {
+    v = bigInt(v);
+    const terms = [];
+    let e = 0;
+    while (v.greater(0)) {
+        if (v.isOdd()) {
+            const d = 2 - v.mod(4).toJSNumber();    // 1 or -1
+            terms.push([d, e]);
+            v = v.minus(d);
+        }
+        v = v.shiftRight(1);
+        e++;
+    }
+    return terms;
+}
+
+// Returns null if q does not have any of the shapes
+function specialForm(q) {
+    q = bigInt(q);
+    const n64 = Math.floor((q.bitLength() - 1) / 64)+1;
+    if (q.bitLength() != 64*n64) return null;
+    const c = bigInt.one.shiftLeft(64*n64).minus(q);
+    if (c.geq(bigInt.one.shiftLeft(64))) return null;
+
+    const cTerms = naf(c);
+    if ((cTerms.length == 2)&&(cTerms[0][1] == 0)&&(cTerms[1][0] == 1)&&(cTerms[1][1] < 64)) {
+        // 2^a + 1 or 2^a - 1
+        return {type: "solinas", c: c, a: cTerms[1][1], sign: cTerms[0][0]};
+    }
+    return {type: "pseudoMersenne", c: c};
+}
+
+// Same interface as the second loop of templateMontgomery. m = t[0]*np is left in rdx, m*c in
+// registers 1:0 (its low word is t[0]), and then the window is shifted down.
+function buildReductionStep(form) {
+    return function reductionStep(c, params) {
+        const {t, n64} = params;
+        c.code.push(`; SecondLoop (${form.type})`);
+        c.op("mov", "rdx", 2);
+        c.op("mulx", 0, "rdx", t);
+        if (form.type == "solinas") {
+            // m*2^a +- m
+            c.op("mov", 0, "rdx");
+            c.op("mov", 1, "rdx");
+            c.op("shl", 0, `${form.a}`);
+            c.op("shr", 1, `${64 - form.a}`);
+            c.op(form.sign > 0 ? "add" : "sub", 0, "rdx");
+            c.op(form.sign > 0 ? "adc" : "sbb", 1, 3);
+        } else {
+            c.op("mulx", 1, 0, "[qc]");
+        }
+        // Word 0 cancels, m*c is subtracted from words 1.. and m added to word n64
+        for (let j=1; j<=n64; j++) {
+            c.op(j==1 ? "sub" : "sbb", t+j, j==1 ? 1 : 3);
+        }
+        c.op("sbb", t+n64+1, 3);
+        c.op("add", t+n64, "rdx");
+        c.op("adc", t+n64+1, 3);
+        for (let j=1; j<=n64+1; j++) {
+            c.op("mov", t+j-1, t+j);
+        }
+        // The next row starts with CF and OF clear
+        c.op("xor", 3, 3);
+    };
+}
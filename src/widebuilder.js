@@ -0,0 +1,330 @@
+const bigInt = require("big-integer");
+const AsmBuilder = require("./asmbuilder");
+const montgomeryRegs = require("./montgomerybuilder").montgomeryRegs;
+const freeTopBit = require("./montgomerybuilder").freeTopBit;
+
+// Montgomery multiplication for the wide fields (n64 >= 6).
+//
+// The CIOS window of templateMontgomery needs n64+1 or n64+2 registers and from 7 limbs on
+// AsmBuilder spills it to the stack, so every row reloads and stores most of the words. These
+// versions do the product and the reduction separately (SOS) on a 2*n64+1 words buffer T in the
+// stack, in blocks of at most 6x6 limbs. A block only keeps 8 words of T in registers, and each
+// word of T is loaded and stored once per block.
+//
+//   blocked     T = a*b in column blocks of b, then the reduction in blocks of rows and of q
+//   karatsuba   T = a*b with one level of Karatsuba over the two halves (n64 even, <= 12)
+//
+// The reduction rows of the first column block compute m = T[i]*np and save it, the other
+// column blocks reuse it. The results are the same as the CIOS functions and fr.cpp picks the
+// fastest one when it starts.
+
+module.exports.canBuildBlocked = canBuildBlocked;
+module.exports.canBuildKaratsuba = canBuildKaratsuba;
+module.exports.buildMulBlocked = buildMulBlocked;
+module.exports.buildMulKaratsuba = buildMulKaratsuba;
+
+const BLOCK = 6;
+// Rotating window: 0 and 1 take the mulx results, 3 is zero and rdx the multiplier.
+const W = [2, 4, 5, 6, 7, 8, 9, 10];
+const NREGS = 11;
+
+function getN64(q) {
+    return Math.floor((q.bitLength() - 1) / 64)+1;
+}
+
+function canBuildBlocked(q) {
+    return getN64(q) >= 6;
+}
+
+function canBuildKaratsuba(q) {
+    const n64 = getN64(q);
+    return (n64 >= 8)&&(n64 <= 2*BLOCK)&&(n64 % 2 == 0)&&(montgomeryRegs(q) > NREGS);
+}
+
+// Words in the stack, off is in words from rsp. live[k] is false while the word is not
+// written or it is known to be zero.
+class StackBuffer {
+    constructor(off, n) {
+        this.off = off;
+        this.n = n;
+        this.live = new Array(n).fill(false);
+    }
+
+    ref(k) {
+        return `[rsp + ${(this.off + k)*8}]`;
+    }
+}
+
+class WideBuilder {
+    constructor(fn, q) {
+        this.fn = fn;
+        this.q = q;
+        this.n64 = getN64(q);
+        this.canOptimizeConsensys = freeTopBit(q);
+        this.c = new AsmBuilder(fn, NREGS);
+        this.nLabels = 0;
+        this.stackWords = 0;
+    }
+
+    alloc(n) {
+        const b = new StackBuffer(this.stackWords, n);
+        this.stackWords += n;
+        return b;
+    }
+
+    label() {
+        this.nLabels ++;
+        return `${this.fn}_l${this.nLabels}`;
+    }
+
+    // Adds x(r)*y << 64*(o+r) to buf for r < nr, y has ny <= 6 words given by y(j).
+    // If x is null the multiplier of the row is m = buf[o+r]*np, which zeroes the word, and it
+    // is saved in mRef(r). The carry out of the block goes up through the live words of buf.
+    //
+    // R(r+ny+1) is the carry word of row r. When buf[o+r+ny] is not live the window plus the
+    // words below are < 2^(64*(o+r+ny+1)), so the row can not carry out (as in buildMulWide).
+    accumulate(buf, o, nr, x, ny, y, mRef) {
+        const c = this.c;
+        const R = (k) => W[k % W.length];
+        const fresh = [];
+        for (let r=0; r<nr; r++) fresh[r] = !buf.live[o+r+ny];
+
+        c.op("xor", 0, 0);
+        for (let k=0; k<=ny; k++) {
+            c.op("mov", R(k), buf.live[o+k] ? buf.ref(o+k) : 3);
+        }
+        if (!fresh[0]) c.op("mov", R(ny+1), 3);
+
+        for (let r=0; r<nr; r++) {
+            if (x) {
+                c.op("mov", "rdx", x(r));
+            } else {
+                c.op("mov", "rdx", "[np]");
+                c.op("mulx", 1, "rdx", R(r));
+                c.op("mov", mRef(r), "rdx");
+            }
+            for (let j=0; j<ny; j++) {
+                c.op("mulx", 1, 0, y(j));
+                c.op("adcx", R(r+j), 0);
+                c.op("adox", R(r+j+1), 1);
+            }
+            c.op("adcx", R(r+ny), 3);
+            if (!fresh[r]) {
+                c.op("adcx", R(r+ny+1), 3);
+                c.op("adox", R(r+ny+1), 3);
+            }
+
+            if (x) {
+                c.op("mov", buf.ref(o+r), R(r));
+                buf.live[o+r] = true;
+            } else {
+                buf.live[o+r] = false;
+            }
+
+            if (r < nr-1) {
+                const p = o+r+ny+1;
+                if (fresh[r]) {
+                    // Top word of the next row
+                    c.op("mov", R(r+ny+1), 3);
+                } else if (buf.live[p]) {
+                    // The carry word gets the next word of buf and a new carry word starts
+                    c.op("add", R(r+ny+1), buf.ref(p));
+                    c.op("mov", R(r+ny+2), 3);
+                    c.op("adc", R(r+ny+2), 3);
+                } else if (!fresh[r+1]) {
+                    c.op("mov", R(r+ny+2), 3);
+                }
+            }
+        }
+
+        for (let k=0; k<ny; k++) {
+            c.op("mov", buf.ref(o+nr+k), R(nr+k));
+            buf.live[o+nr+k] = true;
+        }
+        if (!fresh[nr-1]) this.addCarry(buf, o+nr+ny, R(nr+ny));
+    }
+
+    // Writes zero in the words of buf that are not live
+    materialize(buf) {
+        for (let k=0; k<buf.n; k++) {
+            if (!buf.live[k]) {
+                this.c.op("mov", buf.ref(k), 3);
+                buf.live[k] = true;
+            }
+        }
+    }
+
+    // buf[p..] += reg, reg is small
+    addCarry(buf, p, reg) {
+        const c = this.c;
+        if (p >= buf.n) return;     // The value fits in buf so the carry is 0
+        if (!buf.live[p]) {
+            c.op("mov", buf.ref(p), reg);
+            buf.live[p] = true;
+            return;
+        }
+        for (let k=p+1; k<buf.n; k++) {
+            if (!buf.live[k]) {
+                c.op("mov", buf.ref(k), 3);
+                buf.live[k] = true;
+            }
+        }
+        const lbl = this.label();
+        c.op("add", buf.ref(p), reg);
+        c.code.push(`    jnc ${lbl}`);
+        for (let k=p+1; k<buf.n; k++) {
+            c.op("adc", buf.ref(k), 3);
+        }
+        c.code.push(`${lbl}:`);
+    }
+
+    productBlocked(T) {
+        const n64 = this.n64;
+        for (let jb=0; jb<n64; jb += BLOCK) {
+            this.c.code.push(`; Product, columns ${jb}`);
+            this.accumulate(T, jb, n64, (r) => `[rsi + ${r*8}]`, Math.min(BLOCK, n64-jb), (j) => `[rcx + ${(jb+j)*8}]`);
+        }
+    }
+
+    // a*b = L + (M - L - H)*2^(64*h) + H*2^(128*h), with L = a0*b0, H = a1*b1 and
+    // M = (a0 + a1)*(b0 + b1). The sums have one more bit, in sa[h] and in the mask cb.
+    productKaratsuba(T) {
+        const c = this.c;
+        const n64 = this.n64;
+        const h = n64/2;
+        const sa = this.alloc(h+1);
+        const sb = this.alloc(h);
+        const cb = this.alloc(1);
+        const M = this.alloc(2*h+2);
+
+        c.code.push("; Product, L and H");
+        this.accumulate(T, 0, h, (r) => `[rsi + ${r*8}]`, h, (j) => `[rcx + ${j*8}]`);
+        this.accumulate(T, 2*h, h, (r) => `[rsi + ${(h+r)*8}]`, h, (j) => `[rcx + ${(h+j)*8}]`);
+        this.materialize(T);
+
+        c.code.push("; Product, sums of the halves");
+        for (let k=0; k<h; k++) {
+            c.op("mov", 0, `[rsi + ${k*8}]`);
+            c.op(k==0 ? "add" : "adc", 0, `[rsi + ${(h+k)*8}]`);
+            c.op("mov", sa.ref(k), 0);
+        }
+        c.op("mov", 0, 3);
+        c.op("adc", 0, 3);
+        c.op("mov", sa.ref(h), 0);
+        for (let k=0; k<h; k++) {
+            c.op("mov", 0, `[rcx + ${k*8}]`);
+            c.op(k==0 ? "add" : "adc", 0, `[rcx + ${(h+k)*8}]`);
+            c.op("mov", sb.ref(k), 0);
+        }
+        c.op("sbb", 0, 0);
+        c.op("mov", cb.ref(0), 0);
+        for (let k=0; k<=h; k++) sa.live[k] = true;
+        for (let k=0; k<h; k++) sb.live[k] = true;
+
+        c.code.push("; Product, M");
+        this.accumulate(M, 0, h+1, (r) => sa.ref(r), h, (j) => sb.ref(j));
+        this.materialize(M);
+        // The high bit of b0 + b1 times a0 + a1
+        for (let k=0; k<=h; k++) {
+            c.op("mov", W[k], sa.ref(k));
+            c.op("and", W[k], cb.ref(0));
+        }
+        for (let k=0; k<=h; k++) {
+            c.op(k==0 ? "add" : "adc", M.ref(h+k), W[k]);
+        }
+        c.op("adc", M.ref(2*h+1), 3);
+
+        c.code.push("; Product, (M - L - H)*2^(64*h)");
+        for (let s=0; s<2; s++) {
+            for (let k=0; k<2*h+2; k++) {
+                c.op("mov", 0, M.ref(k));
+                c.op(k==0 ? "sub" : "sbb", 0, k<2*h ? T.ref(2*h*s+k) : 3);
+                c.op("mov", M.ref(k), 0);
+            }
+        }
+        for (let k=0; k<2*h+2; k++) {
+            c.op("mov", 0, M.ref(k));
+            c.op(k==0 ? "add" : "adc", T.ref(h+k), 0);
+        }
+        const lbl = this.label();
+        c.code.push(`    jnc ${lbl}`);
+        for (let k=3*h+2; k<T.n; k++) {
+            c.op("adc", T.ref(k), 3);
+        }
+        c.code.push(`${lbl}:`);
+    }
+
+    // T = (T + m*q) / 2^(64*n64), the result is in T[n64..2*n64]
+    reduce(T, mBuf) {
+        const n64 = this.n64;
+        for (let ib=0; ib<n64; ib += BLOCK) {
+            const nr = Math.min(BLOCK, n64-ib);
+            for (let jb=0; jb<n64; jb += BLOCK) {
+                this.c.code.push(`; Reduction, rows ${ib} columns ${jb}`);
+                this.accumulate(T, ib+jb, nr,
+                    jb == 0 ? null : (r) => mBuf.ref(ib+r),
+                    Math.min(BLOCK, n64-jb), (j) => `[q + ${(jb+j)*8}]`,
+                    (r) => mBuf.ref(ib+r));
+            }
+        }
+    }
+
+    // rdi = T[n64..2*n64] - q if it is >= q
+    store(T) {
+        const c = this.c;
+        const fn = this.fn;
+        const n64 = this.n64;
+
+        c.code.push(";comparison");
+        if ((!this.canOptimizeConsensys)&&(T.live[2*n64])) {
+            c.op("mov", 0, T.ref(2*n64));
+            c.op("test", 0, 0);
+            c.code.push(`    jnz ${fn}_sq`);
+        }
+        for (let i=n64-1; i>=0; i--) {
+            c.op("mov", 0, T.ref(n64+i));
+            c.op("cmp", 0, `[q + ${i*8}]`);
+            c.code.push(`    jc ${fn}_done`);
+            c.code.push(`    jnz ${fn}_sq`);
+        }
+
+        c.code.push(fn+ "_sq:");
+        for (let i=0; i<n64; i++) {
+            c.op("mov", 0, T.ref(n64+i));
+            c.op(i==0 ? "sub" : "sbb", 0, `[q + ${i*8}]`);
+            c.op("mov", `[rdi + ${i*8}]`, 0);
+        }
+        c.code.push(`    jmp ${fn}_end`);
+
+        c.code.push(fn+ "_done:");
+        for (let i=0; i<n64; i++) {
+            c.op("mov", 0, T.ref(n64+i));
+            c.op("mov", `[rdi + ${i*8}]`, 0);
+        }
+        c.code.push(fn+ "_end:");
+    }
+
+    build(product) {
+        const c = this.c;
+        const T = this.alloc(2*this.n64+1);
+        const mBuf = this.alloc(this.n64);
+
+        c.op("mov", "rcx", "rdx");
+        c.op("xor", 3, 3);
+        product.call(this, T);
+        this.reduce(T, mBuf);
+        this.store(T);
+
+        c.code.unshift(`    sub rsp, ${this.stackWords*8}`);
+        c.code.push(`    add rsp, ${this.stackWords*8}`);
+        return c.getCode();
+    }
+}
+
+function buildMulBlocked(fn, q) {
+    return new WideBuilder(fn, bigInt(q)).build(WideBuilder.prototype.productBlocked);
+}
+
+function buildMulKaratsuba(fn, q) {
+    return new WideBuilder(fn, bigInt(q)).build(WideBuilder.prototype.productKaratsuba);
+}
@@ -56,6 +56,7 @@ function testAltBn128() {
         " ../c/alt_bn128.cpp"+
         " ../c/alt_bn128_test.cpp"+
         " ../c/misc.cpp"+
+        " ../c/goldilocks.cpp"+
         " fq.cpp"+
         " fq.o"+
         " fr.cpp"+
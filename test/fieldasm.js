@@ -12,6 +12,7 @@ const secp256k1r = new bigInt("FFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFEBAAEDCE6AF48A03BB
 const mnt6753q = new bigInt("41898490967918953402344214791240637128170709919953949071783502921025352812571106773058893763790338921418070971888458477323173057491593855069696241854796396165721416325350064441470418137846398469611935719059908164220784476160001");
 const mnt6753r = new bigInt("41898490967918953402344214791240637128170709919953949071783502921025352812571106773058893763790338921418070971888253786114353726529584385201591605722013126468931404347949840543007986327743462853720628051692141265303114721689601");
 const gl = new bigInt("FFFFFFFF00000001", 16);
+const m61 = bigInt.one.shiftLeft(61).minus(1);
 
 describe("field asm test", function () {
     this.timeout(1000000000);
@@ -111,8 +112,12 @@ describe("field asm test", function () {
 
     }
 
-    generateTest(bn128r, "gl");
+    generateTest(gl, "gl");
+    generateTest(m61, "2^61-1");
+    generateTest(secp256k1q, "secp256k1");
     generateTest(bn128r, "bn128");
+    generateTest(bls12_381q, "bls12-381");
+    generateTest(mnt6753q, "mnt6753");
 });
 
 function buildTestVector2(p, op) {